@@ -0,0 +1,108 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "expr.h"
+
+// Samples per pass; roughly a few dozen curves re-sampled across a wide window
+#define SAMPLES (1 << 16)
+#define MIN_SECONDS 0.5
+
+typedef struct
+{
+    const char* source;
+    double (*native)(double x);
+} Case;
+
+static double native_parabola(double x) { return x * x + 3; }
+static double native_damped(double x) { return sin(x) * exp(-x * x / 10); }
+static double native_poly(double x) { return ((2 * x - 3) * x + 1) * x - 7; }
+static double native_mixed(double x) { return sqrt(fabs(x)) + cos(3 * x) / (1 + x * x); }
+
+static const Case CASES[] = {
+    {"y = x^2 + 3", native_parabola},
+    {"y = sin(x)*exp(-x^2/10)", native_damped},
+    {"y = ((2x - 3)x + 1)x - 7", native_poly},
+    {"y = sqrt(|x|) + cos(3x)/(1 + x^2)", native_mixed},
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static volatile double sink;
+
+static double bench_batched(const Expr* e, const double* xs, double* ys)
+{
+    size_t total = 0;
+    double start = now(), elapsed;
+    do {
+        expr_eval(e, xs, ys, SAMPLES);
+        sink = ys[SAMPLES - 1];
+        total += SAMPLES;
+    } while ((elapsed = now() - start) < MIN_SECONDS);
+    return total / elapsed;
+}
+
+static double bench_bytecode_scalar(const Expr* e, const double* xs, double* ys)
+{
+    size_t total = 0;
+    double start = now(), elapsed;
+    do {
+        for (size_t i = 0; i < SAMPLES; i++)
+            ys[i] = expr_eval_scalar(e, xs[i]);
+        sink = ys[SAMPLES - 1];
+        total += SAMPLES;
+    } while ((elapsed = now() - start) < MIN_SECONDS);
+    return total / elapsed;
+}
+
+static double bench_native(double (*f)(double), const double* xs, double* ys)
+{
+    size_t total = 0;
+    double start = now(), elapsed;
+    do {
+        for (size_t i = 0; i < SAMPLES; i++)
+            ys[i] = f(xs[i]);
+        sink = ys[SAMPLES - 1];
+        total += SAMPLES;
+    } while ((elapsed = now() - start) < MIN_SECONDS);
+    return total / elapsed;
+}
+
+int main(void)
+{
+    double* xs = malloc(SAMPLES * sizeof(double));
+    double* ys = malloc(SAMPLES * sizeof(double));
+    for (size_t i = 0; i < SAMPLES; i++)
+        xs[i] = -10.0 + 20.0 * i / SAMPLES;
+
+    printf("%-36s %14s %14s %14s\n", "expression", "batched/s", "scalar vm/s", "native C/s");
+    for (size_t c = 0; c < sizeof(CASES) / sizeof(CASES[0]); c++) {
+        Expr e;
+        if (!expr_compile(&e, CASES[c].source)) {
+            fprintf(stderr, "%s: %s\n", CASES[c].source, e.error);
+            return 1;
+        }
+
+        double max_error = 0;
+        expr_eval(&e, xs, ys, SAMPLES);
+        for (size_t i = 0; i < SAMPLES; i++)
+            max_error = fmax(max_error, fabs(ys[i] - CASES[c].native(xs[i])));
+        if (max_error > 1e-9) {
+            fprintf(stderr, "%s: result differs from native by %g\n", CASES[c].source, max_error);
+            return 1;
+        }
+
+        printf("%-36s %14.3e %14.3e %14.3e\n", CASES[c].source, bench_batched(&e, xs, ys),
+               bench_bytecode_scalar(&e, xs, ys), bench_native(CASES[c].native, xs, ys));
+    }
+
+    free(xs);
+    free(ys);
+    return 0;
+}
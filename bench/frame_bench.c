@@ -0,0 +1,357 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plot.h"
+#include "raylib.h"
+#include "rlgl.h"
+
+// Usage: frame_bench [output.json] [max points]
+// Renders scripted zoom and pan sequences offscreen through the same functions the window uses,
+// for data series of 1e3 up to 1e8 points (or the given maximum), for sampled expressions and for
+// implicit relations.
+// Each frame is split into the phases of the main loop: input, sampling, grid, curves and
+// present. Sampling waits until the pool has finished every chunk and tile the view asked for,
+// so the curves drawn are the final ones, and present waits for the GPU. The p50/p95/p99 of every
+// phase and the heap allocations per frame go to the JSON file (frame_bench.json by default).
+//
+// The window stays hidden but still needs a display; on a server run it under `xvfb-run -a`,
+// with LIBGL_ALWAYS_SOFTWARE=1 to use Mesa's software rasterizer.
+
+#define FRAMES 240
+#define WARMUP_FRAMES 10
+#define WIDTH 1280
+#define HEIGHT 720
+
+// Waits for the GPU so the present phase includes the work the frame queued
+#ifdef _WIN32
+__declspec(dllimport) void __stdcall glFinish(void);
+#else
+void glFinish(void);
+#endif
+
+// The benchmark is linked with -Wl,--wrap for these, so every allocation made by the plot code
+// and the statically linked raylib goes through here first. Only the render thread's count per
+// frame; the pool's workers allocate at their own pace and are only totaled.
+static _Thread_local bool render_thread = false;
+static size_t allocations = 0;
+static atomic_size_t worker_allocations = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+static void count_allocation(void)
+{
+    if (render_thread)
+        allocations++;
+    else
+        atomic_fetch_add_explicit(&worker_allocations, 1, memory_order_relaxed);
+}
+
+void* __wrap_malloc(size_t size)
+{
+    count_allocation();
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    count_allocation();
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* p, size_t size)
+{
+    count_allocation();
+    return __real_realloc(p, size);
+}
+
+typedef enum
+{
+    PHASE_INPUT,
+    PHASE_SAMPLING,
+    PHASE_GRID,
+    PHASE_CURVES,
+    PHASE_PRESENT,
+    PHASE_FRAME, // Sum of the others
+    PHASE_COUNT,
+} Phase;
+
+static const char* PHASE_NAMES[PHASE_COUNT] = {
+    "input", "sampling", "grid", "curves", "present", "frame",
+};
+
+typedef struct
+{
+    double times[PHASE_COUNT][FRAMES];
+    size_t allocations[FRAMES];
+    int frames;
+    double mark;
+} Profile;
+
+// Ends the running phase of the current frame and starts the next one
+static void profile_phase(Profile* profile, Phase phase)
+{
+    const double t = now();
+    profile->times[phase][profile->frames] = t - profile->mark;
+    profile->mark = t;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, int count, double p)
+{
+    int index = (int)ceil(p * count) - 1;
+    return sorted[index < 0 ? 0 : index];
+}
+
+typedef enum
+{
+    SCRIPT_ZOOM, // Zooms in towards the center, then back out
+    SCRIPT_PAN,  // Drags the view right, down, left and up
+} Script;
+
+static PlotInput scripted_input(Script script, int frame)
+{
+    const int quarter = FRAMES / 4;
+    PlotInput input = {0};
+    if (script == SCRIPT_ZOOM) {
+        input.wheel = frame % 4 != 0 ? 0.0f : frame < FRAMES / 2 ? 1.0f : -1.0f;
+    } else {
+        const Vector2 DIRECTIONS[] = {{12, 0}, {0, 8}, {-12, 0}, {0, -8}};
+        input.dragging = true;
+        input.drag = DIRECTIONS[(frame / quarter) % 4];
+    }
+    return input;
+}
+
+typedef struct
+{
+    const char* name;
+    Script script;
+    size_t points; // Samples per data series; 0 for expressions
+    const char* const* expressions;
+    int num_of_expressions;
+} Scenario;
+
+// Random walk with x = 0, 1, 2, ...
+static void make_series(Curve* curve, size_t count)
+{
+    curve->xs = malloc(count * sizeof(double));
+    curve->ys = malloc(count * sizeof(double));
+    if (curve->xs == NULL || curve->ys == NULL) {
+        fprintf(stderr, "cannot allocate %zu points\n", count);
+        exit(1);
+    }
+
+    unsigned long long state = 88172645463325252ull;
+    double y = 0;
+    for (size_t i = 0; i < count; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        y += (double)(state >> 11) / (double)(1ull << 53) - 0.5;
+        curve->xs[i] = (double)i;
+        curve->ys[i] = y;
+    }
+    curve->count = count;
+    lod_build(&curve->lod, curve->ys, count);
+    curve->dirty = true;
+}
+
+static void run(const Scenario* scenario, RenderTexture2D target, ThreadPool* pool, FILE* json,
+                bool first)
+{
+    const Rectangle bounds = {0, 0, WIDTH, HEIGHT};
+    CoordPlane cp = coord_plane_init();
+    GridLayer grid_layer = {0};
+
+    const size_t num_of_curves =
+        scenario->points > 0 ? 1 : (size_t)scenario->num_of_expressions;
+    Curve* curves = calloc(num_of_curves, sizeof(Curve));
+    for (size_t i = 0; i < num_of_curves; i++) {
+        curves[i].color = curve_color(i);
+        if (scenario->points > 0) {
+            make_series(&curves[i], scenario->points);
+        } else if (!expr_compile(&curves[i].expr, scenario->expressions[i])) {
+            fprintf(stderr, "%s: %s\n", scenario->expressions[i], curves[i].expr.error);
+            exit(1);
+        }
+    }
+    if (scenario->points > 0) {
+        size_t min_index, max_index;
+        lod_range_minmax(&curves[0].lod, curves[0].ys, 0, curves[0].count, &min_index,
+                         &max_index);
+        coord_plane_fit(&cp, bounds, curves[0].xs[0], curves[0].xs[curves[0].count - 1],
+                        curves[0].ys[min_index], curves[0].ys[max_index]);
+    }
+
+    static Profile profile;
+    memset(&profile, 0, sizeof(profile));
+    const size_t worker_allocations_before = atomic_load(&worker_allocations);
+    for (int frame = 0; frame < WARMUP_FRAMES + FRAMES; frame++) {
+        const bool measured = frame >= WARMUP_FRAMES;
+        const size_t allocations_before = allocations;
+        profile.mark = now();
+
+        update(&cp, scripted_input(scenario->script, measured ? frame - WARMUP_FRAMES : 0));
+        profile_phase(&profile, PHASE_INPUT);
+
+        // Chunks that finish later are picked up by asking again, as the next frames would
+        for (bool pending = true; pending;) {
+            pending = false;
+            for (size_t i = 0; i < num_of_curves; i++) {
+                if (curve_pending(&curves[i]))
+                    pending = true;
+                curve_sample(&curves[i], bounds, cp, pool);
+                if (curve_pending(&curves[i]))
+                    pending = true;
+            }
+            if (pending)
+                WaitTime(0.0002);
+        }
+        profile_phase(&profile, PHASE_SAMPLING);
+
+        grid_layer_update(&grid_layer, bounds, cp);
+        profile_phase(&profile, PHASE_GRID);
+
+        BeginTextureMode(target);
+        ClearBackground(BACKGROUND);
+        grid_layer_draw(&grid_layer);
+        for (size_t i = 0; i < num_of_curves; i++) {
+            plot_points(bounds, cp, &curves[i]);
+        }
+        profile_phase(&profile, PHASE_CURVES);
+
+        EndTextureMode();
+        glFinish();
+        profile_phase(&profile, PHASE_PRESENT);
+
+        if (measured) {
+            double total = 0;
+            for (int phase = 0; phase < PHASE_FRAME; phase++)
+                total += profile.times[phase][profile.frames];
+            profile.times[PHASE_FRAME][profile.frames] = total;
+            profile.allocations[profile.frames] = allocations - allocations_before;
+            profile.frames++;
+        }
+    }
+
+    size_t total_allocations = 0, max_allocations = 0;
+    for (int i = 0; i < profile.frames; i++) {
+        total_allocations += profile.allocations[i];
+        if (profile.allocations[i] > max_allocations)
+            max_allocations = profile.allocations[i];
+    }
+
+    fprintf(json, "%s\n    {\"name\": \"%s\", \"points\": %zu, \"curves\": %zu, \"frames\": %d,\n",
+            first ? "" : ",", scenario->name, scenario->points, num_of_curves, profile.frames);
+    const size_t pool_allocations = atomic_load(&worker_allocations) - worker_allocations_before;
+    fprintf(json, "     \"allocations_per_frame\": {\"mean\": %.2f, \"max\": %zu},\n",
+            (double)total_allocations / profile.frames, max_allocations);
+    fprintf(json, "     \"pool_allocations\": %zu,\n", pool_allocations);
+    fprintf(json, "     \"phases_ms\": {");
+    printf("%-16s %10zu", scenario->name, scenario->points);
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        double* times = profile.times[phase];
+        qsort(times, (size_t)profile.frames, sizeof(double), compare_doubles);
+        const double p50 = percentile(times, profile.frames, 0.50) * 1e3;
+        const double p95 = percentile(times, profile.frames, 0.95) * 1e3;
+        const double p99 = percentile(times, profile.frames, 0.99) * 1e3;
+        fprintf(json, "%s\n       \"%s\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f}",
+                phase == 0 ? "" : ",", PHASE_NAMES[phase], p50, p95, p99);
+        printf("  %s %7.3f/%7.3f", PHASE_NAMES[phase], p50, p99);
+    }
+    fprintf(json, "\n     }}");
+    printf("  allocs/frame %.1f\n", (double)total_allocations / profile.frames);
+
+    grid_layer_unload(&grid_layer);
+    for (size_t i = 0; i < num_of_curves; i++)
+        curve_free(&curves[i]);
+    free(curves);
+}
+
+int main(int argc, char** argv)
+{
+    const char* output = argc > 1 ? argv[1] : "frame_bench.json";
+    const size_t max_points = argc > 2 ? (size_t)strtod(argv[2], NULL) : 100000000;
+    render_thread = true;
+
+    SetTraceLogLevel(LOG_WARNING);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(WIDTH, HEIGHT, "frame_bench");
+    font = LoadFontEx("resources/CM Serif Roman.ttf", 20, NULL, 0);
+    label_cache_init(&label_cache, font);
+    if (!polyline_renderer_init()) {
+        fprintf(stderr, "Failed to load the curve shader\n");
+        CloseWindow();
+        return 1;
+    }
+    RenderTexture2D target = LoadRenderTexture(WIDTH, HEIGHT);
+    ThreadPool pool;
+    if (!pool_init(&pool, 0)) {
+        fprintf(stderr, "Failed to start the sampling threads\n");
+        CloseWindow();
+        return 1;
+    }
+
+    FILE* json = fopen(output, "w");
+    if (json == NULL) {
+        perror(output);
+        return 1;
+    }
+    fprintf(json, "{\"width\": %d, \"height\": %d, \"renderer\": \"%s\", \"scenarios\": [", WIDTH,
+            HEIGHT, rlGetVersion() == RL_OPENGL_33 ? "opengl33" : "other");
+    printf("%-16s %10s  phase p50/p99 in ms\n", "scenario", "points");
+
+    static const char* const EXPRESSIONS[] = {
+        "y = sin(x)*exp(-x^2/10)",
+        "y = x^2 + 3",
+        "y = sin(5x)/x",
+    };
+    static const char* const RELATIONS[] = {
+        "x^2 + y^2 = 25",
+        "y < sin(x)",
+    };
+    bool first = true;
+    for (int script = SCRIPT_ZOOM; script <= SCRIPT_PAN; script++) {
+        char name[32];
+        snprintf(name, sizeof(name), "expr_%s", script == SCRIPT_ZOOM ? "zoom" : "pan");
+        const Scenario scenario = {name, script, 0, EXPRESSIONS, 3};
+        run(&scenario, target, &pool, json, first);
+        first = false;
+    }
+    for (int script = SCRIPT_ZOOM; script <= SCRIPT_PAN; script++) {
+        char name[32];
+        snprintf(name, sizeof(name), "implicit_%s", script == SCRIPT_ZOOM ? "zoom" : "pan");
+        const Scenario scenario = {name, script, 0, RELATIONS, 2};
+        run(&scenario, target, &pool, json, first);
+    }
+    for (size_t points = 1000; points <= max_points; points *= 10) {
+        for (int script = SCRIPT_ZOOM; script <= SCRIPT_PAN; script++) {
+            char name[32];
+            snprintf(name, sizeof(name), "series_%s", script == SCRIPT_ZOOM ? "zoom" : "pan");
+            const Scenario scenario = {name, script, points, NULL, 0};
+            run(&scenario, target, &pool, json, first);
+        }
+    }
+    fprintf(json, "\n]}\n");
+    fclose(json);
+    printf("wrote %s\n", output);
+
+    pool_close(&pool);
+    UnloadRenderTexture(target);
+    plot_close();
+    polyline_renderer_close();
+    UnloadFont(font);
+    CloseWindow();
+    return 0;
+}
@@ -0,0 +1,254 @@
+// nanosleep() is not part of strict C17
+#define _DEFAULT_SOURCE
+
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "expr.h"
+#include "implicit.h"
+#include "interval.h"
+#include "pool.h"
+
+// Usage: implicit_bench [workers]
+// Pans and zooms a 1280x720 view over a few implicit relations and inequalities at 60 frames
+// per second. Reports how many evaluations the quadtree and the tile cache need per frame against
+// marching squares over a uniform grid of the same cells, which evaluates every cell corner on
+// every frame, and the render thread's share of the work. "cold" compares a single view computed
+// from an empty cache, which shows what the quadtree saves without the cache. At the end the
+// contour of each relation is checked against the uniform grid.
+
+#define WIDTH 1280
+#define HEIGHT 720
+#define FRAMES 600
+
+static const char* const RELATIONS[] = {
+    "x^2 + y^2 = 25",
+    "y^2 = x^3 - 4x + 1",
+    "sin(x)*cos(y) = 0.3",
+    "y < sin(x)",
+    "x^2/9 + y^2/4 <= 1",
+};
+#define NUM_OF_RELATIONS ((int)(sizeof(RELATIONS) / sizeof(RELATIONS[0])))
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double cpu_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Segments marching squares finds on the uniform grid of cells `cell_x` by `cell_y` covering
+// tiles first_x..last_x by first_y..last_y
+static size_t uniform_segments(const Expr* expr, const long long* tiles, double cell_x,
+                               double cell_y)
+{
+    const long long first_x = tiles[0] * IMPLICIT_TILE, first_y = tiles[2] * IMPLICIT_TILE;
+    const size_t columns = (size_t)(tiles[1] - tiles[0] + 1) * IMPLICIT_TILE + 1;
+    const size_t rows = (size_t)(tiles[3] - tiles[2] + 1) * IMPLICIT_TILE + 1;
+    double* xs = malloc(columns * sizeof(double));
+    double* ys = malloc(columns * sizeof(double));
+    double* below = malloc(columns * sizeof(double));
+    double* above = malloc(columns * sizeof(double));
+
+    size_t segments = 0;
+    for (size_t row = 0; row < rows; row++) {
+        for (size_t i = 0; i < columns; i++) {
+            xs[i] = (double)(first_x + (long long)i) * cell_x;
+            ys[i] = (double)(first_y + (long long)row) * cell_y;
+        }
+        expr_eval_xy(expr, xs, ys, above, columns);
+        for (size_t i = 0; row > 0 && i + 1 < columns; i++) {
+            const double v[4] = {below[i], below[i + 1], above[i + 1], above[i]};
+            if (!isfinite(v[0]) || !isfinite(v[1]) || !isfinite(v[2]) || !isfinite(v[3]))
+                continue;
+            const int mask = (v[0] < 0) | (v[1] < 0) << 1 | (v[2] < 0) << 2 | (v[3] < 0) << 3;
+            segments += mask == 5 || mask == 10 ? 2 : mask != 0 && mask != 15;
+        }
+        double* swap = below;
+        below = above;
+        above = swap;
+    }
+    free(xs);
+    free(ys);
+    free(below);
+    free(above);
+    return segments;
+}
+
+int main(int argc, char** argv)
+{
+    const int workers = argc > 1 ? atoi(argv[1]) : 0;
+
+    ThreadPool pool;
+    if (!pool_init(&pool, workers))
+        return 1;
+
+    static Expr exprs[NUM_OF_RELATIONS];
+    static Implicit implicits[NUM_OF_RELATIONS];
+    for (int i = 0; i < NUM_OF_RELATIONS; i++) {
+        if (!expr_compile(&exprs[i], RELATIONS[i])) {
+            fprintf(stderr, "%s: %s\n", RELATIONS[i], exprs[i].error);
+            return 1;
+        }
+        implicit_init(&implicits[i], &exprs[i]);
+    }
+
+    // Pan right, zoom in, zoom out past the start, pan back
+    double center_x = 0, span = 20;
+    double frame_times[FRAMES];
+    int stale_frames = 0;
+    const double start = now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        const int phase = frame / (FRAMES / 4);
+        if (phase == 0)
+            center_x += span * 12 / WIDTH;
+        else if (phase == 1)
+            span /= 1.01;
+        else if (phase == 2)
+            span *= 1.015;
+        else
+            center_x -= span * 12 / WIDTH;
+
+        const double pixel = span / WIDTH;
+        const double min_x = center_x - span / 2, max_x = center_x + span / 2;
+        const double min_y = -pixel * HEIGHT / 2, max_y = pixel * HEIGHT / 2;
+
+        const double t = cpu_now();
+        bool stale = false;
+        for (int i = 0; i < NUM_OF_RELATIONS; i++) {
+            Implicit* implicit = &implicits[i];
+            implicit_update(implicit, &pool, min_x, max_x, min_y, max_y, pixel, pixel);
+
+            const int level = (int)floor(log2(pixel));
+            const double size = ldexp(IMPLICIT_TILE, level);
+            if (implicit->level_x != level || implicit->level_y != level ||
+                implicit->covered[0] > (long long)floor(min_x / size) ||
+                implicit->covered[1] < (long long)floor(max_x / size) ||
+                implicit->covered[2] > (long long)floor(min_y / size) ||
+                implicit->covered[3] < (long long)floor(max_y / size))
+                stale = true;
+        }
+        frame_times[frame] = cpu_now() - t;
+        stale_frames += stale;
+
+        const double deadline = start + (frame + 1) / 60.0;
+        while (now() < deadline) {
+            struct timespec pause = {0, 500 * 1000};
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    // Marching squares on a uniform grid evaluates every corner of the view on every frame
+    const double uniform_evaluations = (double)(WIDTH + 1) * (HEIGHT + 1);
+    double* xs = malloc((WIDTH + 1) * (HEIGHT + 1) * sizeof(double));
+    double* ys = malloc((WIDTH + 1) * (HEIGHT + 1) * sizeof(double));
+    double* values = malloc((WIDTH + 1) * (HEIGHT + 1) * sizeof(double));
+    for (int row = 0; row <= HEIGHT; row++) {
+        for (int column = 0; column <= WIDTH; column++) {
+            xs[row * (WIDTH + 1) + column] = -10 + 20.0 * column / WIDTH;
+            ys[row * (WIDTH + 1) + column] = -5.625 + 11.25 * row / HEIGHT;
+        }
+    }
+    const double uniform_start = now();
+    for (int i = 0; i < NUM_OF_RELATIONS; i++)
+        expr_eval_xy(&exprs[i], xs, ys, values, (WIDTH + 1) * (HEIGHT + 1));
+    const double uniform_frame = now() - uniform_start;
+
+    // An interval evaluation costs more than a point evaluation; weigh them by measured time
+    const int trials = 200000;
+    const double interval_start = now();
+    static volatile double sink;
+    for (int i = 0; i < trials; i++) {
+        const Interval x = {i * 1e-5, i * 1e-5 + 0.01}, y = {-1, -0.99};
+        sink += interval_eval(&exprs[i % NUM_OF_RELATIONS], x, y).lo;
+    }
+    const double interval_cost = (now() - interval_start) / trials;
+    const double point_cost = uniform_frame / (NUM_OF_RELATIONS * uniform_evaluations);
+
+    printf("%d relations, %d workers, %d frames of pan and zoom at 60 fps over %dx%d\n",
+           NUM_OF_RELATIONS, pool.num_of_workers, FRAMES, WIDTH, HEIGHT);
+    printf("  %-22s %10s %10s %10s %8s %12s\n", "relation", "intervals", "points", "uniform",
+           "fewer", "cold fewer");
+    int mismatches = 0;
+    double total_weighted = 0;
+    for (int i = 0; i < NUM_OF_RELATIONS; i++) {
+        Implicit* implicit = &implicits[i];
+        while (implicit_pending(implicit))
+            sched_yield();
+
+        const double intervals = atomic_load(&implicit->interval_evaluations) / (double)FRAMES;
+        const double points = atomic_load(&implicit->point_evaluations) / (double)FRAMES;
+        const double weighted = points + intervals * interval_cost / point_cost;
+        total_weighted += weighted;
+
+        // The same view from an empty cache, against a uniform grid over the same tiles
+        static Implicit cold;
+        implicit_init(&cold, &exprs[i]);
+        const double pixel = span / WIDTH;
+        const double min_y = -pixel * HEIGHT / 2, max_y = pixel * HEIGHT / 2;
+        while (!implicit_update(&cold, &pool, center_x - span / 2, center_x + span / 2, min_y,
+                                max_y, pixel, pixel) ||
+               implicit_pending(&cold))
+            sched_yield();
+        const double cold_weighted = atomic_load(&cold.point_evaluations) +
+                                     atomic_load(&cold.interval_evaluations) * interval_cost /
+                                         point_cost;
+        const double cold_uniform = (double)((cold.covered[1] - cold.covered[0] + 1) *
+                                                 IMPLICIT_TILE + 1) *
+                                    ((cold.covered[3] - cold.covered[2] + 1) * IMPLICIT_TILE + 1);
+        implicit_free(&cold);
+
+        printf("  %-22s %10.0f %10.0f %10.0f %7.1fx %11.1fx\n", RELATIONS[i], intervals, points,
+               uniform_evaluations, uniform_evaluations / weighted, cold_uniform / cold_weighted);
+
+        // Every segment marching squares finds on the uniform grid must survive the pruning
+        size_t breaks = 0;
+        for (size_t j = 0; j < implicit->count; j++)
+            breaks += isnan(implicit->xs[j]);
+        const size_t segments = implicit->count - 2 * breaks;
+        const size_t expected =
+            uniform_segments(&exprs[i], implicit->covered, ldexp(1.0, implicit->level_x),
+                             ldexp(1.0, implicit->level_y));
+        if (segments != expected) {
+            printf("  %s: %zu segments, %zu on the uniform grid\n", RELATIONS[i], segments,
+                   expected);
+            mismatches++;
+        }
+    }
+    qsort(frame_times, FRAMES, sizeof(double), compare_doubles);
+    printf("  evaluations per frame, with an interval weighed as %.1f points: %.0f vs %.0f "
+           "(%.1fx fewer)\n",
+           interval_cost / point_cost, total_weighted, NUM_OF_RELATIONS * uniform_evaluations,
+           NUM_OF_RELATIONS * uniform_evaluations / total_weighted);
+    printf("  render thread CPU per frame:  p50 %.3f ms  p99 %.3f ms  max %.3f ms\n",
+           frame_times[FRAMES / 2] * 1e3, frame_times[FRAMES * 99 / 100] * 1e3,
+           frame_times[FRAMES - 1] * 1e3);
+    printf("  uniform grid on the render thread: %.3f ms per frame\n", uniform_frame * 1e3);
+    printf("  frames showing an older view: %d\n", stale_frames);
+    printf("  relations whose contour differs from the uniform grid: %d\n", mismatches);
+
+    for (int i = 0; i < NUM_OF_RELATIONS; i++)
+        implicit_free(&implicits[i]);
+    pool_close(&pool);
+    free(xs);
+    free(ys);
+    free(values);
+    return mismatches != 0;
+}
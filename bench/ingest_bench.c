@@ -0,0 +1,118 @@
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "loader.h"
+
+// Usage: ingest_bench [size in MB] [directory]
+// Generates a CSV and a raw float64 file of about the given size (1 GB by default) once, then
+// reports how soon the first screen of samples is available and the peak RSS while loading.
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t file_size(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size < 0 ? 0 : (size_t)size;
+}
+
+// Timestamp-like x values show why the columns are doubles: a float cannot tell these apart
+static void sample(size_t i, double* x, double* y)
+{
+    *x = 1.7e9 + i * 1e-3;
+    *y = sin(i * 1e-4) * 100.0 + (double)(i % 97) * 0.01;
+}
+
+static void generate(const char* path, size_t bytes, LoaderFormat format)
+{
+    if (file_size(path) >= bytes)
+        return;
+
+    printf("generating %s (%zu MB)...\n", path, bytes >> 20);
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        exit(1);
+    }
+    if (format == LOADER_CSV)
+        fprintf(f, "time,value\n");
+
+    size_t written = 0;
+    for (size_t i = 0; written < bytes; i++) {
+        double xy[2];
+        sample(i, &xy[0], &xy[1]);
+        if (format == LOADER_CSV) {
+            int n = fprintf(f, "%.3f,%.6f\n", xy[0], xy[1]);
+            written += n > 0 ? (size_t)n : 0;
+        } else {
+            fwrite(xy, sizeof(xy), 1, f);
+            written += sizeof(xy);
+        }
+    }
+    fclose(f);
+}
+
+static void run(const char* path, LoaderFormat format)
+{
+    Loader loader;
+    const double start = now();
+    if (!loader_start(&loader, path, format))
+        exit(1);
+
+    double first_screen = -1;
+    while (!atomic_load(&loader.done)) {
+        if (first_screen < 0 && atomic_load(&loader.published) >= LOADER_BATCH)
+            first_screen = now() - start;
+        sched_yield();
+    }
+    const double total = now() - start;
+    if (first_screen < 0)
+        first_screen = total;
+
+    const size_t count = atomic_load(&loader.published);
+    double x, y;
+    sample(count - 1, &x, &y);
+    if (format == LOADER_CSV) {
+        char text[64];
+        snprintf(text, sizeof(text), "%.3f", x);
+        x = strtod(text, NULL);
+    }
+    const bool exact = loader.xs[count - 1] == x;
+
+    printf("%-4s %12zu samples  first screen %8.2f ms  total %7.2f s  %8.1f MB/s  "
+           "sorted %s  last x %s\n",
+           format == LOADER_CSV ? "csv" : "f64", count, first_screen * 1e3, total,
+           file_size(path) / total / (1 << 20), atomic_load(&loader.sorted) ? "yes" : "no",
+           exact ? "exact" : "WRONG");
+    printf("     peak RSS so far: %.1f MB\n", peak_rss_bytes() / (double)(1 << 20));
+    loader_close(&loader);
+}
+
+int main(int argc, char** argv)
+{
+    const size_t bytes = (argc > 1 ? strtoull(argv[1], NULL, 10) : 1024) << 20;
+    const char* dir = argc > 2 ? argv[2] : ".";
+
+    char csv_path[512], f64_path[512];
+    snprintf(csv_path, sizeof(csv_path), "%s/ingest_%zumb.csv", dir, bytes >> 20);
+    snprintf(f64_path, sizeof(f64_path), "%s/ingest_%zumb.f64", dir, bytes >> 20);
+    generate(csv_path, bytes, LOADER_CSV);
+    generate(f64_path, bytes, LOADER_F64);
+
+    run(csv_path, LOADER_CSV);
+    run(f64_path, LOADER_F64);
+    return 0;
+}
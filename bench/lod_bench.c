@@ -0,0 +1,193 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lod.h"
+
+#define POINTS 10000000
+#define COLUMNS 1920
+#define MIN_SECONDS 0.5
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static volatile double sink;
+
+// What plot_points did before: project every point and keep the ones inside the view
+static size_t cull_all(const double* xs, const double* ys, size_t n, double min_x, double max_x)
+{
+    size_t visible = 0;
+    double acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (xs[i] >= min_x && xs[i] <= max_x) {
+            acc += (xs[i] - min_x) * ys[i];
+            visible++;
+        }
+    }
+    sink = acc;
+    return visible;
+}
+
+typedef struct
+{
+    size_t count;
+    double first, last, min, max;
+} Column;
+
+// Same column boundaries as lod_decimate
+static int column_of(double x, double min_x, double max_x)
+{
+    const double width = (max_x - min_x) / COLUMNS;
+    int c = (int)((x - min_x) / width);
+    c = c < 0 ? 0 : (c > COLUMNS - 1 ? COLUMNS - 1 : c);
+    while (c > 0 && x < min_x + c * width)
+        c--;
+    while (c < COLUMNS - 1 && x >= min_x + (c + 1) * width)
+        c++;
+    return c;
+}
+
+// Per-column first/last/min/max of the points that fall in each column. Two polylines with equal
+// columns rasterize to the same pixels at one pixel per column.
+static void column_extents(const double* xs, const double* ys, const size_t* indices, size_t n,
+                           double min_x, double max_x, Column* columns)
+{
+    for (int c = 0; c < COLUMNS; c++)
+        columns[c] = (Column){0};
+
+    for (size_t j = 0; j < n; j++) {
+        size_t i = indices ? indices[j] : j;
+        if (xs[i] < min_x || xs[i] > max_x)
+            continue;
+
+        Column* col = &columns[column_of(xs[i], min_x, max_x)];
+        if (col->count == 0) {
+            col->first = col->min = col->max = ys[i];
+        }
+        col->last = ys[i];
+        col->min = fmin(col->min, ys[i]);
+        col->max = fmax(col->max, ys[i]);
+        col->count++;
+    }
+}
+
+static int check_same(const Column* raw, const Column* lod)
+{
+    for (int c = 0; c < COLUMNS; c++) {
+        if ((raw[c].count == 0) != (lod[c].count == 0) || raw[c].first != lod[c].first ||
+            raw[c].last != lod[c].last || raw[c].min != lod[c].min || raw[c].max != lod[c].max)
+            return 0;
+    }
+    return 1;
+}
+
+// Whether the line through the kept points breaks wherever the full line does. Two finite points
+// may only be joined across a non-finite one within a pixel column that shows a break anyway.
+static int check_breaks(const double* xs, const double* ys, const size_t* indices, size_t n,
+                        double min_x, double max_x)
+{
+    static char broken[COLUMNS];
+    memset(broken, 0, sizeof(broken));
+    for (size_t j = 0; j < n; j++) {
+        if (!isfinite(ys[indices[j]]))
+            broken[column_of(xs[indices[j]], min_x, max_x)] = 1;
+    }
+
+    for (size_t j = 0; j + 1 < n; j++) {
+        const size_t a = indices[j], b = indices[j + 1];
+        if (!isfinite(ys[a]) || !isfinite(ys[b]))
+            continue;
+        for (size_t i = a + 1; i < b; i++) {
+            const int c = column_of(xs[a], min_x, max_x);
+            if (!isfinite(ys[i]) && (c != column_of(xs[b], min_x, max_x) || !broken[c]))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+int main(void)
+{
+    double* xs = malloc(POINTS * sizeof(double));
+    double* ys = malloc(POINTS * sizeof(double));
+    size_t* indices = malloc((5 * COLUMNS + 2) * sizeof(size_t));
+
+    srand(1);
+    double y = 0;
+    for (size_t i = 0; i < POINTS; i++) {
+        y += (double)rand() / RAND_MAX - 0.5;
+        xs[i] = (double)i;
+        ys[i] = y;
+    }
+
+    LodPyramid lod = {0};
+    double start = now();
+    lod_build(&lod, ys, POINTS);
+    printf("build: %d levels over %d points in %.1f ms\n", lod.levels, POINTS,
+           (now() - start) * 1e3);
+
+    const double spans[] = {1.0, 0.1, 1e-3, 1e-4};
+    printf("%-10s %10s %14s %14s %10s\n", "span", "kept", "decimate us", "cull all us", "same");
+    for (size_t s = 0; s < sizeof(spans) / sizeof(spans[0]); s++) {
+        const double min_x = POINTS * (0.5 - spans[s] / 2);
+        const double max_x = POINTS * (0.5 + spans[s] / 2);
+
+        size_t kept = 0, iterations = 0;
+        start = now();
+        do {
+            kept = lod_decimate(&lod, xs, ys, min_x, max_x, COLUMNS, indices);
+            iterations++;
+        } while (now() - start < MIN_SECONDS);
+        double decimate_us = (now() - start) / iterations * 1e6;
+
+        iterations = 0;
+        start = now();
+        do {
+            cull_all(xs, ys, POINTS, min_x, max_x);
+            iterations++;
+        } while (now() - start < MIN_SECONDS);
+        double cull_us = (now() - start) / iterations * 1e6;
+
+        Column* raw = malloc(COLUMNS * sizeof(Column));
+        Column* reduced = malloc(COLUMNS * sizeof(Column));
+        column_extents(xs, ys, NULL, POINTS, min_x, max_x, raw);
+        column_extents(xs, ys, indices, kept, min_x, max_x, reduced);
+        int same = check_same(raw, reduced);
+        free(raw);
+        free(reduced);
+
+        printf("%-10g %10zu %14.1f %14.1f %10s\n", spans[s], kept, decimate_us, cull_us,
+               same ? "yes" : "NO");
+        if (!same)
+            return 1;
+    }
+
+    // Short runs of NaN anywhere in the series must survive as breaks at every zoom level
+    for (int g = 0; g < 1000; g++) {
+        const size_t at = (size_t)((double)rand() / RAND_MAX * (POINTS - 3));
+        ys[at] = ys[at + 1] = ys[at + 2] = NAN;
+    }
+    lod_build(&lod, ys, POINTS);
+    for (size_t s = 0; s < sizeof(spans) / sizeof(spans[0]); s++) {
+        const double min_x = POINTS * (0.5 - spans[s] / 2);
+        const double max_x = POINTS * (0.5 + spans[s] / 2);
+        const size_t kept = lod_decimate(&lod, xs, ys, min_x, max_x, COLUMNS, indices);
+        const int breaks = check_breaks(xs, ys, indices, kept, min_x, max_x);
+        printf("gaps, span %-6g %5zu kept, breaks kept: %s\n", spans[s], kept,
+               breaks ? "yes" : "NO");
+        if (!breaks)
+            return 1;
+    }
+
+    lod_free(&lod);
+    free(xs);
+    free(ys);
+    free(indices);
+    return 0;
+}
@@ -0,0 +1,255 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lod.h"
+#include "query.h"
+
+// Usage: query_bench [max points]
+// Hover, intersection and extrema queries over two random walks of 1e6 and 1e8 points (or up to
+// the given maximum) in a 1920x1080 view at three zoom levels. Each kind of query is timed
+// against the linear scan a frame would need without the index, and checked against it.
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define CURSORS 1000
+#define CHECKS 10
+#define RADIUS 24    // Pixels, as in the window
+#define PROMINENCE 8 // Pixels
+#define MAX_RESULTS 1024
+#define MIN_SECONDS 0.2
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double pixel_distance(ViewTransform view, double x, double y, double world_x,
+                             double world_y)
+{
+    const double dx = (x - world_x) * fabs(view.scale_x), dy = (y - world_y) * fabs(view.scale_y);
+    return dx * dx + dy * dy;
+}
+
+// Squared pixel distance from the cursor to the nearest sample within the radius, by looking at
+// every sample the way a hover without an index would
+static double scan_nearest(const double* xs, const double* ys, size_t n, ViewTransform view,
+                           double screen_x, double screen_y)
+{
+    const double world_x = (screen_x - view.offset_x) / view.scale_x;
+    const double world_y = (screen_y - view.offset_y) / view.scale_y;
+    double best = RADIUS * RADIUS;
+    for (size_t i = 0; i < n; i++)
+        best = fmin(best, pixel_distance(view, xs[i], ys[i], world_x, world_y));
+    return best;
+}
+
+// Sign changes of a - b over the samples first..last, which share their x values
+static size_t scan_intersections(const double* xs, const double* a, const double* b,
+                                 size_t first, size_t last, QueryPoint* out)
+{
+    size_t len = 0;
+    for (size_t i = first; i < last && len < MAX_RESULTS; i++) {
+        const double du = a[i] - b[i], dv = a[i + 1] - b[i + 1];
+        if (du == 0) {
+            out[len++] = (QueryPoint){xs[i], a[i]};
+        } else if ((du < 0 && dv > 0) || (du > 0 && dv < 0)) {
+            const double t = du / (du - dv);
+            out[len++] =
+                (QueryPoint){xs[i] + t * (xs[i + 1] - xs[i]), a[i] + t * (a[i + 1] - a[i])};
+        }
+    }
+    return len;
+}
+
+// The zigzag of query_extrema, looking at every sample
+static size_t scan_extrema(const double* ys, size_t at, size_t end, double prominence,
+                           QueryExtremum* out)
+{
+    size_t len = 0, low = at, high = at;
+    int trend = 0;
+    for (size_t j = at + 1; j < end && len < MAX_RESULTS; j++) {
+        if (trend == 0) {
+            if (ys[j] > ys[high])
+                high = j;
+            else if (ys[j] < ys[low])
+                low = j;
+            if (ys[high] - ys[low] > prominence) {
+                trend = high > low ? 1 : -1;
+                out[len++] = trend > 0 ? (QueryExtremum){low, false} : (QueryExtremum){high, true};
+            }
+        } else if (trend > 0) {
+            if (ys[j] > ys[high]) {
+                high = j;
+            } else if (ys[j] < ys[high] - prominence) {
+                out[len++] = (QueryExtremum){high, true};
+                low = j;
+                trend = -1;
+            }
+        } else {
+            if (ys[j] < ys[low]) {
+                low = j;
+            } else if (ys[j] > ys[low] + prominence) {
+                out[len++] = (QueryExtremum){low, false};
+                high = j;
+                trend = 1;
+            }
+        }
+    }
+    return len;
+}
+
+static bool run(size_t points)
+{
+    double* xs = malloc(points * sizeof(double));
+    double* ya = malloc(points * sizeof(double));
+    double* yb = malloc(points * sizeof(double));
+    if (xs == NULL || ya == NULL || yb == NULL) {
+        fprintf(stderr, "cannot allocate %zu points\n", points);
+        free(xs);
+        free(ya);
+        free(yb);
+        return false;
+    }
+
+    srand(1);
+    double a = 0, b = 0;
+    for (size_t i = 0; i < points; i++) {
+        a += (double)rand() / RAND_MAX - 0.5;
+        b += (double)rand() / RAND_MAX - 0.5;
+        xs[i] = (double)i;
+        ya[i] = a;
+        yb[i] = b;
+    }
+
+    LodPyramid lod_a = {0}, lod_b = {0};
+    double start = now();
+    lod_build(&lod_a, ya, points);
+    lod_build(&lod_b, yb, points);
+    printf("%zu points: both indexes built in %.1f ms\n", points, (now() - start) * 1e3);
+    const QuerySeries series_a = {xs, ya, &lod_a}, series_b = {xs, yb, &lod_b};
+
+    bool same = true;
+    static QueryPoint crossings[MAX_RESULTS], scanned_crossings[MAX_RESULTS];
+    static QueryExtremum extrema[MAX_RESULTS], scanned_extrema[MAX_RESULTS];
+    const double spans[] = {1.0, 1e-2, 1e-4};
+    for (size_t s = 0; s < sizeof(spans) / sizeof(spans[0]); s++) {
+        // A view centered on the middle of the series, fit to what is visible
+        const size_t first = (size_t)(points * (0.5 - spans[s] / 2));
+        const size_t last = (size_t)(points * (0.5 + spans[s] / 2)) - 1;
+        size_t a_min, a_max, b_min, b_max;
+        lod_range_minmax(&lod_a, ya, first, last + 1, &a_min, &a_max);
+        lod_range_minmax(&lod_b, yb, first, last + 1, &b_min, &b_max);
+        const double min_x = xs[first], max_x = xs[last];
+        const double min_y = fmin(ya[a_min], yb[b_min]), max_y = fmax(ya[a_max], yb[b_max]);
+        const double scale_x = WIDTH / (max_x - min_x), scale_y = -HEIGHT / (max_y - min_y);
+        const ViewTransform view = {scale_x, scale_y, -scale_x * min_x, HEIGHT - scale_y * min_y};
+
+        // Half of the cursors anywhere in the view, half a few pixels off the curve
+        static double latencies[CURSORS];
+        double scan_seconds = 0;
+        for (int c = 0; c < CURSORS; c++) {
+            double screen_x = (double)rand() / RAND_MAX * WIDTH;
+            double screen_y = (double)rand() / RAND_MAX * HEIGHT;
+            if (c % 2 == 1) {
+                const size_t i = first + (size_t)((double)rand() / RAND_MAX * (last - first));
+                screen_x = view.offset_x + scale_x * xs[i] + (double)rand() / RAND_MAX * 20 - 10;
+                screen_y = view.offset_y + scale_y * ya[i] + (double)rand() / RAND_MAX * 20 - 10;
+            }
+
+            start = now();
+            const size_t index = query_nearest(series_a, view, screen_x, screen_y, RADIUS);
+            latencies[c] = now() - start;
+
+            if (c < CHECKS) {
+                start = now();
+                const double best = scan_nearest(xs, ya, points, view, screen_x, screen_y);
+                scan_seconds += now() - start;
+                const double found =
+                    index == QUERY_NONE
+                        ? RADIUS * RADIUS
+                        : pixel_distance(view, xs[index], ya[index],
+                                         (screen_x - view.offset_x) / view.scale_x,
+                                         (screen_y - view.offset_y) / view.scale_y);
+                if (fabs(found - best) > 1e-6)
+                    same = false;
+            }
+        }
+        qsort(latencies, CURSORS, sizeof(double), compare_doubles);
+
+        size_t num_of_crossings = 0;
+        int iterations = 0;
+        start = now();
+        do {
+            num_of_crossings =
+                query_intersections(series_a, series_b, min_x, max_x, crossings, MAX_RESULTS);
+            iterations++;
+        } while (now() - start < MIN_SECONDS);
+        const double crossings_seconds = (now() - start) / iterations;
+        start = now();
+        const size_t scanned = scan_intersections(xs, ya, yb, first, last, scanned_crossings);
+        const double crossings_scan_seconds = now() - start;
+        same = same && scanned == num_of_crossings;
+        for (size_t i = 0; same && i < num_of_crossings; i++) {
+            const double x = crossings[i].x;
+            if (fabs(x - scanned_crossings[i].x) > 1e-9 * fmax(1, fabs(x)))
+                same = false;
+        }
+
+        const double prominence = PROMINENCE / fabs(scale_y);
+        size_t num_of_extrema = 0;
+        iterations = 0;
+        start = now();
+        do {
+            num_of_extrema =
+                query_extrema(series_a, min_x, max_x, prominence, extrema, MAX_RESULTS);
+            iterations++;
+        } while (now() - start < MIN_SECONDS);
+        const double extrema_seconds = (now() - start) / iterations;
+        start = now();
+        const size_t scanned_extremes =
+            scan_extrema(ya, first, last + 1, prominence, scanned_extrema);
+        const double extrema_scan_seconds = now() - start;
+        same = same && scanned_extremes == num_of_extrema;
+        for (size_t i = 0; same && i < num_of_extrema; i++) {
+            if (extrema[i].index != scanned_extrema[i].index ||
+                extrema[i].maximum != scanned_extrema[i].maximum)
+                same = false;
+        }
+
+        printf("  span %-6g nearest p50 %6.2f us  p99 %7.2f us  (scan %8.2f ms)\n", spans[s],
+               latencies[CURSORS / 2] * 1e6, latencies[CURSORS * 99 / 100] * 1e6,
+               scan_seconds / CHECKS * 1e3);
+        printf("  %11s %4zu crossings in %8.2f us  (scan %8.2f ms)\n", "", num_of_crossings,
+               crossings_seconds * 1e6, crossings_scan_seconds * 1e3);
+        printf("  %11s %4zu extrema   in %8.2f us  (scan %8.2f ms)\n", "", num_of_extrema,
+               extrema_seconds * 1e6, extrema_scan_seconds * 1e3);
+    }
+    printf("  same results as the scans: %s\n", same ? "yes" : "NO");
+
+    lod_free(&lod_a);
+    lod_free(&lod_b);
+    free(xs);
+    free(ya);
+    free(yb);
+    return same;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t max_points = argc > 1 ? (size_t)strtod(argv[1], NULL) : 100000000;
+    bool same = true;
+    for (size_t points = 1000000; points <= max_points; points *= 100)
+        same = run(points) && same;
+    return !same;
+}
@@ -0,0 +1,176 @@
+// nanosleep() is not part of strict C17
+#define _DEFAULT_SOURCE
+
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "expr.h"
+#include "pool.h"
+#include "sampler.h"
+
+// Usage: sample_bench [curves] [workers]
+// Pans and zooms a 1280 pixel wide view over 50 curves (by default) at 60 frames per second and
+// measures the render thread's share of resampling, how many frames showed samples of an older
+// view, and how many function evaluations the chunk cache saved compared to resampling every
+// curve from scratch on each change.
+
+#define WIDTH 1280
+#define FRAMES 600
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// CPU time of the calling thread, which leaves out the time the workers take from it when
+// there are fewer cores than threads
+static double cpu_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static const char* const TEMPLATES[] = {
+    "y = sin(%dx)*3",        "y = tan(x/%d)",        "y = 1/(x-%d)",
+    "y = x^3/%d - x",        "y = sqrt(x+%d)",       "y = exp(-x^2/%d)*cos(4x)*5",
+    "y = floor(x/%d)",       "y = ln(|x|+%d)",       "y = sin(x^2/%d)",
+    "y = |sin(x)|*%d - 4",
+};
+
+int main(int argc, char** argv)
+{
+    const int num_of_curves = argc > 1 ? atoi(argv[1]) : 50;
+    const int workers = argc > 2 ? atoi(argv[2]) : 0;
+
+    ThreadPool pool;
+    if (!pool_init(&pool, workers))
+        return 1;
+
+    Expr* exprs = calloc((size_t)num_of_curves, sizeof(Expr));
+    Sampler* samplers = calloc((size_t)num_of_curves, sizeof(Sampler));
+    for (int i = 0; i < num_of_curves; i++) {
+        char source[64];
+        const int templates = (int)(sizeof(TEMPLATES) / sizeof(TEMPLATES[0]));
+        snprintf(source, sizeof(source), TEMPLATES[i % templates], 1 + i / templates);
+        if (!expr_compile(&exprs[i], source)) {
+            fprintf(stderr, "%s: %s\n", source, exprs[i].error);
+            return 1;
+        }
+        sampler_init(&samplers[i], &exprs[i]);
+    }
+
+    // Pan right, zoom in, zoom out past the start, pan back
+    double center = 0, span = 20;
+    double frame_times[FRAMES];
+    int stale_frames = 0;
+    const double start = now();
+    for (int frame = 0; frame < FRAMES; frame++) {
+        const int phase = frame / (FRAMES / 4);
+        if (phase == 0)
+            center += span * 12 / WIDTH;
+        else if (phase == 1)
+            span /= 1.02;
+        else if (phase == 2)
+            span *= 1.03;
+        else
+            center -= span * 12 / WIDTH;
+
+        const double min_x = center - span / 2, max_x = center + span / 2;
+        const double pixel_x = span / WIDTH;
+        const double pixel_y = pixel_x;
+
+        const double t = cpu_now();
+        bool stale = false;
+        for (int i = 0; i < num_of_curves; i++) {
+            Sampler* sampler = &samplers[i];
+            sampler_update(sampler, &pool, min_x, max_x, pixel_x, pixel_y);
+
+            const double width = ldexp(SAMPLER_CHUNK, sampler->level);
+            if (sampler->count == 0 || sampler->level != (int)floor(log2(pixel_x)) ||
+                sampler->first > (long long)floor(min_x / width) ||
+                sampler->last < (long long)floor(max_x / width))
+                stale = true;
+        }
+        frame_times[frame] = cpu_now() - t;
+        stale_frames += stale;
+
+        // Wait for the next frame the way a vsynced window would
+        const double deadline = start + (frame + 1) / 60.0;
+        while (now() < deadline) {
+            struct timespec pause = {0, 500 * 1000};
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    // Let the last requests finish, then check the stitched samples against direct evaluation
+    for (int i = 0; i < num_of_curves; i++) {
+        while (sampler_pending(&samplers[i]))
+            sched_yield();
+    }
+    const double min_x = center - span / 2, max_x = center + span / 2;
+    size_t evaluations = 0, samples = 0, mismatches = 0;
+    for (int i = 0; i < num_of_curves; i++) {
+        Sampler* sampler = &samplers[i];
+        sampler_update(sampler, &pool, min_x, max_x, span / WIDTH, span / WIDTH);
+        while (sampler_pending(sampler))
+            sched_yield();
+        sampler_update(sampler, &pool, min_x, max_x, span / WIDTH, span / WIDTH);
+
+        evaluations += atomic_load(&sampler->evaluations);
+        samples += sampler->count;
+        for (size_t j = 0; j < sampler->count; j++) {
+            const double y = expr_eval_scalar(&exprs[i], sampler->xs[j]);
+            const bool same = y == sampler->ys[j] || (isnan(y) && isnan(sampler->ys[j])) ||
+                              isnan(sampler->ys[j]); // Line breaks at discontinuities
+            mismatches += !same;
+        }
+    }
+
+    // The view changes on every frame, so sampling from scratch would evaluate three screen
+    // widths of every curve each frame
+    const double naive_evaluations = (double)FRAMES * num_of_curves * (3 * WIDTH + 1);
+    double* xs = malloc((3 * WIDTH + 1) * sizeof(double));
+    double* ys = malloc((3 * WIDTH + 1) * sizeof(double));
+    for (int j = 0; j <= 3 * WIDTH; j++)
+        xs[j] = -30 + 60.0 * j / (3 * WIDTH);
+    const double naive_start = now();
+    for (int i = 0; i < num_of_curves; i++)
+        expr_eval(&exprs[i], xs, ys, 3 * WIDTH + 1);
+    const double naive_frame = now() - naive_start;
+
+    qsort(frame_times, FRAMES, sizeof(double), compare_doubles);
+    printf("%d curves, %d workers, %d frames of pan and zoom at 60 fps\n", num_of_curves,
+           pool.num_of_workers, FRAMES);
+    printf("  render thread CPU per frame:  p50 %.3f ms  p99 %.3f ms  max %.3f ms\n",
+           frame_times[FRAMES / 2] * 1e3, frame_times[FRAMES * 99 / 100] * 1e3,
+           frame_times[FRAMES - 1] * 1e3);
+    printf("  frames showing an older view: %d\n", stale_frames);
+    printf("  evaluations: %zu cached vs %.0f from scratch (%.1fx fewer)\n", evaluations,
+           naive_evaluations, naive_evaluations / (double)evaluations);
+    printf("  from-scratch sampling on the render thread: %.3f ms per frame\n", naive_frame * 1e3);
+    printf("  final view: %.2f samples per pixel column, %zu samples differ from direct "
+           "evaluation\n",
+           (double)samples / num_of_curves / (2 * WIDTH), mismatches);
+
+    for (int i = 0; i < num_of_curves; i++)
+        sampler_free(&samplers[i]);
+    pool_close(&pool);
+    free(samplers);
+    free(exprs);
+    free(xs);
+    free(ys);
+    return mismatches != 0;
+}
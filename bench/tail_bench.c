@@ -0,0 +1,87 @@
+// popen() and nanosleep() are not part of strict C17
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ring.h"
+#include "tail.h"
+
+// Usage: tail_bench [samples per second] [seconds] [generator]
+// Starts the tail_gen generator as a separate process sending to a local UDP port and drains the
+// ring at 60 frames per second the way the render loop does. Reports how many samples were lost
+// in the kernel, dropped by the ring, and how long they waited between producer and consumer.
+
+#define PORT 47611
+#define RING_CAPACITY (1 << 16)
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv)
+{
+    const double rate = argc > 1 ? atof(argv[1]) : 200000;
+    const double seconds = argc > 2 ? atof(argv[2]) : 3;
+    const char* generator = argc > 3 ? argv[3] : "bin/bench/tail_gen";
+
+    char source[32];
+    snprintf(source, sizeof(source), "udp:%d", PORT);
+    Tail tail;
+    if (!tail_start(&tail, source, RING_CAPACITY))
+        return 1;
+
+    char command[512];
+    snprintf(command, sizeof(command), "%s %.0f %g %s", generator, rate, seconds, source);
+    FILE* process = popen(command, "r");
+    if (process == NULL) {
+        perror(command);
+        return 1;
+    }
+
+    const size_t expected = (size_t)(rate * seconds);
+    double* latencies = malloc(expected * sizeof(double));
+    TailSample* frame = malloc(RING_CAPACITY * sizeof(TailSample));
+    size_t drained = 0, frames = 0;
+
+    // Keep draining a little after the generator is done so the last datagrams arrive
+    const double end = now() + seconds + 0.5;
+    while (now() < end) {
+        struct timespec pause = {0, 1000 * 1000 * 1000 / 60};
+        nanosleep(&pause, NULL);
+
+        const size_t count = ring_pop(&tail.ring, frame, RING_CAPACITY);
+        const double drain_time = now();
+        for (size_t i = 0; i < count && drained < expected; i++)
+            latencies[drained++] = drain_time - frame[i].time;
+        frames++;
+    }
+    pclose(process);
+    tail_close(&tail);
+
+    const size_t received = atomic_load(&tail.received);
+    const size_t dropped = atomic_load(&tail.dropped);
+    printf("rate %.0f/s for %g s over UDP, %zu frames\n", rate, seconds, frames);
+    printf("  sent %zu  received %zu  lost in transit %zu  dropped by ring %zu  drained %zu\n",
+           expected, received, expected > received ? expected - received : 0, dropped, drained);
+    if (drained > 0) {
+        qsort(latencies, drained, sizeof(double), compare_doubles);
+        printf("  producer -> consumer latency ms: p50 %.2f  p99 %.2f  max %.2f\n",
+               latencies[drained / 2] * 1e3, latencies[drained * 99 / 100] * 1e3,
+               latencies[drained - 1] * 1e3);
+    }
+    free(latencies);
+    free(frame);
+    return 0;
+}
@@ -0,0 +1,91 @@
+// nanosleep() and the socket API are not part of strict C17
+#define _DEFAULT_SOURCE
+
+#include <arpa/inet.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Usage: tail_gen [samples per second] [seconds] [udp:PORT]
+// Produces "x,y,time" lines at a steady rate for the live tail mode: x is seconds since the start,
+// y a noisy sine and time the wall clock when the sample was made. Lines go to standard output,
+// or to 127.0.0.1:PORT as datagrams of several lines. Runs until killed when seconds is 0.
+//
+//     bin/bench/tail_gen 200000 | bin/release/plot-gui -
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+    const double rate = argc > 1 ? atof(argv[1]) : 100000;
+    const double seconds = argc > 2 ? atof(argv[2]) : 0;
+    const char* target = argc > 3 ? argv[3] : NULL;
+
+    int s = -1;
+    struct sockaddr_in address = {0};
+    if (target != NULL && strncmp(target, "udp:", 4) == 0) {
+        s = socket(AF_INET, SOCK_DGRAM, 0);
+        address.sin_family = AF_INET;
+        address.sin_port = htons((unsigned short)atoi(target + 4));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (s < 0) {
+            perror("socket");
+            return 1;
+        }
+    }
+
+    // Samples are written in small bursts every millisecond, datagrams stay below the usual MTU
+    char buffer[1400];
+    size_t used = 0;
+    const double start = now();
+    unsigned int noise = 1;
+    for (size_t i = 0; seconds <= 0 || i < (size_t)(rate * seconds); i++) {
+        const double x = i / rate;
+        while (now() - start < x) {
+            struct timespec pause = {0, 1000 * 1000};
+            nanosleep(&pause, NULL);
+        }
+
+        noise = noise * 1103515245u + 12345u;
+        const double y = sin(2 * M_PI * x) + ((noise >> 16) % 1000) * 1e-4;
+        char line[96];
+        const int n = snprintf(line, sizeof(line), "%.6f,%.6f,%.6f\n", x, y, now());
+
+        if (s >= 0) {
+            if (used + (size_t)n > sizeof(buffer)) {
+                sendto(s, buffer, used, 0, (struct sockaddr*)&address, sizeof(address));
+                used = 0;
+            }
+            memcpy(buffer + used, line, (size_t)n);
+            used += (size_t)n;
+        } else {
+            fwrite(line, 1, (size_t)n, stdout);
+        }
+
+        // Flush whenever the generator is about to wait so consumers see samples promptly
+        if ((i + 1) / rate > now() - start) {
+            if (s >= 0 && used > 0) {
+                sendto(s, buffer, used, 0, (struct sockaddr*)&address, sizeof(address));
+                used = 0;
+            } else if (s < 0 && fflush(stdout) != 0) {
+                break; // The reader went away
+            }
+        }
+    }
+    if (s >= 0 && used > 0)
+        sendto(s, buffer, used, 0, (struct sockaddr*)&address, sizeof(address));
+    fflush(stdout);
+    if (s >= 0)
+        close(s);
+    return 0;
+}
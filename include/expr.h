@@ -0,0 +1,100 @@
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of samples evaluated together by one pass over the bytecode. Every instruction is a tight
+// loop over this many lanes, which the compiler turns into SIMD code.
+#define EXPR_LANES 128
+#define EXPR_MAX_CODE 128
+#define EXPR_MAX_CONSTS 64
+#define EXPR_MAX_REGS 16
+
+typedef enum
+{
+    OP_X,
+    OP_Y,
+    OP_CONST,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_POW,
+    OP_ADDK,
+    OP_SUBK,
+    OP_KSUB,
+    OP_MULK,
+    OP_DIVK,
+    OP_KDIV,
+    OP_POWK,
+    OP_KPOW,
+    OP_NEG,
+    OP_SQR,
+    OP_SIN,
+    OP_COS,
+    OP_TAN,
+    OP_ASIN,
+    OP_ACOS,
+    OP_ATAN,
+    OP_SINH,
+    OP_COSH,
+    OP_TANH,
+    OP_EXP,
+    OP_LN,
+    OP_LOG,
+    OP_SQRT,
+    OP_ABS,
+    OP_FLOOR,
+    OP_CEIL,
+} ExprOp;
+
+// Register-based instruction: `dst = op(a, b)`. For the *K variants `b` indexes the constant
+// table instead of a register.
+typedef struct
+{
+    uint8_t op;
+    uint8_t dst;
+    uint8_t a;
+    uint8_t b;
+} ExprInstr;
+
+// What the program computes. An explicit curve is y = f(x). A relation in x and y is compiled
+// to the difference of its sides, moved around so the plotted set is where the value is zero (for
+// EXPR_EQUAL) or below zero.
+typedef enum
+{
+    EXPR_EXPLICIT,
+    EXPR_EQUAL,
+    EXPR_LESS,
+    EXPR_LESS_EQUAL,
+} ExprRelation;
+
+typedef struct
+{
+    ExprRelation relation;
+    ExprInstr code[EXPR_MAX_CODE];
+    double consts[EXPR_MAX_CONSTS];
+    int code_len;
+    int consts_len;
+    int regs_used;
+    int result;
+
+    char error[96];
+} Expr;
+
+// Parses a Desmos-style expression such as "y = sin(x)*exp(-x^2/10)", "x^2 + y^2 = 25" or
+// "y < sin(x)" into `expr`. On failure returns false and leaves a message in `expr->error`.
+bool expr_compile(Expr* expr, const char* source);
+
+// Evaluates an explicit program for each of the `count` inputs in `xs`, writing the results into
+// `ys`.
+void expr_eval(const Expr* expr, const double* xs, double* ys, size_t count);
+// Evaluates a relation at the `count` points (`xs[i]`, `ys[i]`)
+void expr_eval_xy(const Expr* expr, const double* xs, const double* ys, double* values,
+                  size_t count);
+
+double expr_eval_scalar(const Expr* expr, double x);
+
+#endif // EXPR_H
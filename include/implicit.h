@@ -0,0 +1,80 @@
+#ifndef IMPLICIT_H
+#define IMPLICIT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "expr.h"
+#include "pool.h"
+#include "sampler.h"
+
+// Cells per tile side, tiles cached per relation and most tiles one request may cover
+#define IMPLICIT_TILE 128
+#define IMPLICIT_CACHE 2048
+#define IMPLICIT_MAX_TILES 1024
+
+// One tile of a dyadic grid of cells 2^level_x by 2^level_y world units: tile (`ix`, `iy`)
+// covers [ix, ix + 1) * IMPLICIT_TILE * 2^level_x by the same in y. Cells are at most a pixel
+// across, so marching squares on them gives a curve without visible corners.
+typedef struct
+{
+    int level_x;
+    int level_y;
+    long long ix;
+    long long iy;
+    atomic_int state; // ChunkState
+    unsigned last_used;
+
+    // Written by a worker before it publishes the tile as ready; read-only afterwards. The
+    // boundary is a set of lines broken by NaN; the inside of an inequality is a list of
+    // triangles, as x, y pairs.
+    double* xs;
+    double* ys;
+    size_t count;
+    double* triangles;
+    size_t triangle_count; // Vertices
+} ImplicitTile;
+
+// Plots where a relation in x and y holds on a thread pool. Each tile is subdivided as a
+// quadtree: boxes whose interval bounds leave out zero are dropped, or filled whole for an
+// inequality, and marching squares runs only on the single cells left over. Tiles stay cached,
+// so a pan only computes the newly exposed ones. Like Sampler, the tiles covering the view are
+// stitched into `xs`/`ys` and `triangles` only once all of them are ready.
+typedef struct
+{
+    const Expr* expr;
+    ImplicitTile tiles[IMPLICIT_CACHE];
+    atomic_int jobs;                     // Tiles queued or being computed
+    atomic_size_t interval_evaluations; // Quadtree boxes bounded so far
+    atomic_size_t point_evaluations;    // Cell corners evaluated so far
+    unsigned frame;
+
+    // The last request, and the tiles behind what is stitched
+    long long request[6];
+    bool complete; // The whole prefetch range was ready when it was stitched
+    int level_x;
+    int level_y;
+    long long covered[4]; // First and last tile in x, then in y
+
+    double* xs;
+    double* ys;
+    size_t count;
+    size_t capacity;
+    double* triangles;
+    size_t triangle_count;
+    size_t triangle_capacity;
+} Implicit;
+
+void implicit_init(Implicit* implicit, const Expr* expr);
+// Waits for the queued tiles and frees everything
+void implicit_free(Implicit* implicit);
+
+// Requests the relation over [min_x, max_x] by [min_y, max_y] for a view of `pixel_x` by
+// `pixel_y` world units per pixel, plus one tile on each side. Returns true when the stitched
+// output was replaced by a complete set of tiles for this view.
+bool implicit_update(Implicit* implicit, ThreadPool* pool, double min_x, double max_x,
+                     double min_y, double max_y, double pixel_x, double pixel_y);
+bool implicit_pending(Implicit* implicit);
+
+#endif // IMPLICIT_H
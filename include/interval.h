@@ -0,0 +1,23 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include <stdbool.h>
+
+#include "expr.h"
+
+// Closed range of values. An interval with lo > hi is empty.
+typedef struct
+{
+    double lo;
+    double hi;
+} Interval;
+
+bool interval_empty(Interval a);
+
+// Bounds of the values the expression takes over the box `x` by `y`, found by running its
+// bytecode on intervals instead of numbers. The bounds may be wider than the true range but
+// never narrower, so a box whose interval leaves out zero cannot contain a point of the curve.
+// The result is empty when the expression is undefined everywhere in the box.
+Interval interval_eval(const Expr* expr, Interval x, Interval y);
+
+#endif // INTERVAL_H
@@ -0,0 +1,40 @@
+#ifndef LABEL_CACHE_H
+#define LABEL_CACHE_H
+
+#include <stdbool.h>
+
+#include "raylib.h"
+
+#define LABEL_CACHE_SIZE 256
+#define LABEL_MAX_CHARS 24
+
+typedef struct
+{
+    Rectangle source;
+    Rectangle dest; // Relative to the top left corner of the label
+} GlyphQuad;
+
+// A label laid out once: its measured size and one textured quad per visible glyph
+typedef struct
+{
+    bool used;
+    char text[LABEL_MAX_CHARS];
+    Vector2 size;
+    int glyph_count;
+    GlyphQuad glyphs[LABEL_MAX_CHARS];
+} CachedLabel;
+
+// Open-addressed table of labels keyed by their formatted text
+typedef struct
+{
+    Font font;
+    CachedLabel labels[LABEL_CACHE_SIZE];
+} LabelCache;
+
+void label_cache_init(LabelCache* cache, Font font);
+const CachedLabel* label_cache_get(LabelCache* cache, const char* text);
+
+// Draws the label with its top left corner at `position`, the same way DrawTextEx() would
+void label_draw(const LabelCache* cache, const CachedLabel* label, Vector2 position, Color tint);
+
+#endif // LABEL_CACHE_H
@@ -0,0 +1,54 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Samples parsed between two publications; the first batch is what the first frame can draw
+#define LOADER_BATCH 65536
+
+typedef enum
+{
+    LOADER_CSV, // One "x,y" pair per line; ',', ';', tab or spaces separate the values
+    LOADER_F64, // Raw little-endian float64 pairs: x0 y0 x1 y1 ...
+} LoaderFormat;
+
+// Loads a series from a memory-mapped file on a background thread. The samples end up in two
+// double precision columns whose address never changes: they are carved out of a virtual memory
+// reservation sized for the whole file, and pages are only committed as they are written. The
+// first `published` samples may be read at any time while the rest is still being parsed.
+typedef struct
+{
+    LoaderFormat format;
+    double* xs;
+    double* ys;
+    size_t reserved;
+
+    atomic_size_t published;
+    atomic_bool done;
+    atomic_bool cancel;
+    atomic_bool sorted; // Whether the x values published so far are non-decreasing
+    double seconds;
+
+    const unsigned char* data;
+    size_t size;
+    pthread_t thread;
+    bool started;
+} Loader;
+
+// Maps `path` and starts parsing it. Returns false and prints the reason when the file cannot be
+// opened or mapped.
+bool loader_start(Loader* loader, const char* path, LoaderFormat format);
+// Stops the background thread if it is still running and releases the file and the columns
+void loader_close(Loader* loader);
+
+// Parses up to `max` numbers at the start of the text in [line, end), separated by ',', ';', tabs
+// or spaces, and returns how many were read
+int parse_values(const char* line, const char* end, double* values, int max);
+
+// Peak resident set size of the process in bytes
+size_t peak_rss_bytes(void);
+
+#endif // LOADER_H
@@ -0,0 +1,58 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <stddef.h>
+
+// Points per block at the bottom of the pyramid. Ranges shorter than this are scanned directly.
+#define LOD_BLOCK 32
+#define LOD_MAX_LEVELS 48
+
+// Min/max pyramid over the y values of a series whose x values are non-decreasing. Level `l`
+// stores, for every full block of `LOD_BLOCK << l` points, the index of its smallest and largest
+// finite y and of its first non-finite one. Any index range can then be reduced to its extremes
+// in O(log N).
+typedef struct
+{
+    size_t count;
+    int levels;
+    size_t blocks[LOD_MAX_LEVELS];
+    size_t capacity[LOD_MAX_LEVELS];
+    size_t* min_index[LOD_MAX_LEVELS];
+    size_t* max_index[LOD_MAX_LEVELS];
+    size_t* gap_index[LOD_MAX_LEVELS];
+} LodPyramid;
+
+void lod_build(LodPyramid* lod, const double* ys, size_t count);
+// Extends the pyramid to the first `count` values after more were appended to `ys`. Only the new
+// blocks are computed, so a series that grows while it loads costs O(N) overall.
+void lod_extend(LodPyramid* lod, const double* ys, size_t count);
+void lod_free(LodPyramid* lod);
+
+// Finds the indices of the smallest and largest finite y in [begin, end). Both are set to
+// `(size_t)-1` when the range holds no finite value.
+void lod_range_minmax(const LodPyramid* lod, const double* ys, size_t begin, size_t end,
+                      size_t* min_index, size_t* max_index);
+// Finds the first index in [begin, end) whose y is finite and below `lo` or above `hi`, skipping
+// whole blocks that stay inside. Returns `(size_t)-1` when there is none.
+size_t lod_find_outside(const LodPyramid* lod, const double* ys, size_t begin, size_t end,
+                        double lo, double hi);
+// Finds the first index in [begin, end) whose y is not finite, where the line breaks. Returns
+// `(size_t)-1` when there is none.
+size_t lod_find_gap(const LodPyramid* lod, const double* ys, size_t begin, size_t end);
+
+// Reduces the points with x in [min_x, max_x] to at most four per column (first, min, max, last;
+// M4 decimation) when the range is split into `columns` equal columns, plus the first non-finite
+// point of a column so the line still breaks there. The neighbours just outside the range are
+// kept so lines reach the edges. Writes indices in increasing order into `out`, which must hold
+// `5 * columns + 2` entries, and returns how many were written.
+size_t lod_decimate(const LodPyramid* lod, const double* xs, const double* ys, double min_x,
+                    double max_x, int columns, size_t* out);
+// The same for a series whose x values are not sorted, with `x_lod` over its x values. The line
+// runs in index order, so each run of consecutive points that stays in one column is reduced the
+// same way and each run outside the view to its ends. The output grows with the number of times
+// the line crosses a column. Returns `(size_t)-1` when that is more than `max` entries.
+size_t lod_decimate_unsorted(const LodPyramid* x_lod, const LodPyramid* lod, const double* xs,
+                             const double* ys, double min_x, double max_x, int columns,
+                             size_t* out, size_t max);
+
+#endif // LOD_H
@@ -0,0 +1,157 @@
+#ifndef PLOT_H
+#define PLOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "expr.h"
+#include "implicit.h"
+#include "label_cache.h"
+#include "loader.h"
+#include "lod.h"
+#include "polyline.h"
+#include "query.h"
+#include "raylib.h"
+#include "sampler.h"
+#include "tail.h"
+
+// Everything the window draws, kept apart from main() so benchmarks can drive the same code
+
+extern Font font;
+extern LabelCache label_cache;
+
+extern const Color BACKGROUND;
+extern const float MIN_TICKS_PER_QUADRANT;
+extern const float MAX_TICKS_PER_QUADRANT;
+extern const size_t TAIL_RING_CAPACITY;
+extern const size_t TAIL_DEFAULT_MB;
+
+#define ASPECT_RATIO() ((float)GetRenderWidth() / (float)GetRenderHeight())
+
+typedef struct
+{
+    Vector2 ticks_per_quadrant;
+    Vector2 total_ticks;
+    int tick_freq;
+    // Ticks per quadrant along y over the number that makes ticks square. The units of the two
+    // axes step through 1, 2 and 5 on their own, and the y ticks are rescaled with their unit.
+    float stretch_y;
+
+    double min_x;
+    double max_x;
+    double min_y;
+    double max_y;
+
+    Vector2 origin;
+
+    // World coordinates at `origin` and world units per tick. They start at 0 and 1 and are
+    // refit to show data sets whose values are nowhere near the unit range.
+    double offset_x;
+    double offset_y;
+    double unit_x;
+    double unit_y;
+} CoordPlane;
+
+// The grid and its labels are rendered into a texture that is only redrawn when the coordinate
+// plane or the bounds change
+typedef struct
+{
+    RenderTexture2D target;
+    Rectangle bounds;
+    CoordPlane cp;
+    bool valid;
+} GridLayer;
+
+typedef struct
+{
+    Expr expr;
+    Loader* loader; // Data series read from a file instead of sampled from `expr`
+    Tail* tail;     // Live series fed by a reader thread
+    const char* path;
+    bool loaded;
+    bool ended; // The source of a live series ended and its last samples were drained
+    size_t window; // Newest samples a live series keeps; its columns hold twice as many
+    Color color;
+    Sampler sampler;    // Samples of `expr` for the current view; `xs`/`ys` point into it
+    Implicit* implicit; // Used instead when `expr` is a relation in x and y
+
+    double* xs;
+    double* ys;
+    size_t count;
+
+    LodPyramid lod;
+    LodPyramid x_lod; // Extremes of the x values of a data file, which need not be sorted
+    Polyline line;
+    bool dirty;
+    double uploaded_min_x;
+    double uploaded_max_x;
+    int uploaded_columns;
+} Curve;
+
+// The sample under the cursor: `index` into the samples of `curve`, or QUERY_NONE
+typedef struct
+{
+    size_t curve;
+    size_t index;
+} Hover;
+
+// One frame of user input. The window fills it in from raylib; benchmarks script it.
+typedef struct
+{
+    float wheel;
+    bool dragging;
+    Vector2 drag;
+} PlotInput;
+
+double now(void);
+// Smallest 1, 2 or 5 times a power of ten that is at least `value`
+double nice_unit(double value);
+
+// The plane the window starts with: unit ticks centered on the render area
+CoordPlane coord_plane_init(void);
+ViewTransform coord_plane_view(const Rectangle rect, const CoordPlane cp);
+bool coord_plane_equal(const CoordPlane a, const CoordPlane b);
+void coord_plane_fit(CoordPlane* cp, const Rectangle rect, double min_x, double max_x,
+                     double min_y, double max_y);
+
+void grid_layer_update(GridLayer* layer, const Rectangle rect, const CoordPlane cp);
+void grid_layer_draw(const GridLayer* layer);
+void grid_layer_unload(GridLayer* layer);
+
+void plot_point(const Rectangle rect, const CoordPlane cp, double x, double y);
+void plot_points(const Rectangle rect, const CoordPlane cp, Curve* curve);
+Color curve_color(size_t index);
+
+// Returns true when the samples of an expression curve changed
+bool curve_sample(Curve* curve, const Rectangle rect, const CoordPlane cp, ThreadPool* pool);
+// Whether the curve has samples being computed on the pool
+bool curve_pending(Curve* curve);
+bool curve_poll(Curve* curve);
+// Whether the x values of the samples are non-decreasing, which decimation by column and queries
+// need. Only a data file can tell otherwise, as soon as its loader gets to one that is not.
+bool curve_sorted(const Curve* curve);
+bool curve_drain(Curve* curve);
+// Stops the curve's loader or reader thread and frees everything it holds
+void curve_free(Curve* curve);
+void tail_stats_present(const Curve* curves, size_t num_of_curves);
+
+// Finds the sample of any curve nearest to the cursor on screen, if one is close enough to snap to
+Hover hover_find(const Rectangle rect, const CoordPlane cp, const Curve* curves,
+                 size_t num_of_curves, Vector2 cursor);
+// Marks the hovered sample and prints its coordinates next to it
+void hover_draw(const Rectangle rect, const CoordPlane cp, const Curve* curves, const Hover hover);
+// Marks where curves cross each other and the local minima and maxima of each in the view
+void plot_markers(const Rectangle rect, const CoordPlane cp, const Curve* curves,
+                  size_t num_of_curves, bool crossings, bool extrema);
+
+bool fit_to_data(CoordPlane* cp, const Rectangle rect, const Curve* curves, size_t num_of_curves);
+void follow_tail(CoordPlane* cp, const Rectangle rect, const Curve* curves, size_t num_of_curves);
+bool is_data_file(const char* arg, LoaderFormat* format);
+
+PlotInput read_input(void);
+void update(CoordPlane* cp, const PlotInput input);
+
+// Frees the scratch buffers shared by all curves
+void plot_close(void);
+
+#endif // PLOT_H
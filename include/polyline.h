@@ -0,0 +1,44 @@
+#ifndef POLYLINE_H
+#define POLYLINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "raylib.h"
+
+// Maps world coordinates to screen pixels: screen = offset + scale * world
+typedef struct
+{
+    double scale_x;
+    double scale_y;
+    double offset_x;
+    double offset_y;
+} ViewTransform;
+
+// A curve kept on the GPU as one vertex buffer of world-space points. Points are stored relative
+// to `origin_x`/`origin_y` so large coordinates (e.g. timestamps) keep their precision as floats.
+// Each segment is drawn as an instanced quad extruded to a fixed pixel width in the vertex
+// shader, with mitered joins, so panning and zooming only change a uniform.
+typedef struct
+{
+    unsigned int vao;
+    unsigned int vbo;
+    size_t capacity;
+    size_t count;
+
+    double origin_x;
+    double origin_y;
+} Polyline;
+
+// Must be called after InitWindow()
+bool polyline_renderer_init(void);
+void polyline_renderer_close(void);
+
+// Replaces the points of the line with `count` samples from `xs`/`ys`, or only the samples listed
+// in `indices` when it is not NULL. Non-finite samples break the line.
+void polyline_upload(Polyline* line, const double* xs, const double* ys, const size_t* indices,
+                     size_t count);
+void polyline_draw(const Polyline* line, ViewTransform view, float thickness, Color color);
+void polyline_unload(Polyline* line);
+
+#endif // POLYLINE_H
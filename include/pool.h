@@ -0,0 +1,53 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define POOL_MAX_WORKERS 32
+
+typedef void (*PoolTaskFn)(void* arg);
+
+typedef struct
+{
+    PoolTaskFn fn;
+    void* arg;
+} PoolTask;
+
+// Ring of tasks guarded by its own lock. The owning worker takes tasks from the front, in the
+// order they were submitted; idle workers steal from the back.
+typedef struct
+{
+    pthread_mutex_t lock;
+    PoolTask* tasks;
+    size_t capacity;
+    size_t head;
+    size_t count;
+} PoolDeque;
+
+// Work-stealing thread pool. Submitted tasks are spread over the workers' deques, and a worker
+// whose deque runs dry steals from the others before going to sleep.
+typedef struct
+{
+    int num_of_workers;
+    pthread_t threads[POOL_MAX_WORKERS];
+    PoolDeque deques[POOL_MAX_WORKERS];
+    atomic_uint next; // Deque that receives the next submission
+
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t wake;
+    atomic_size_t queued; // Tasks submitted but not yet taken by a worker
+    atomic_bool stop;
+} ThreadPool;
+
+// Starts `num_of_workers` threads, or one per processor but one when it is 0
+bool pool_init(ThreadPool* pool, int num_of_workers);
+// Finishes the queued tasks and joins the workers
+void pool_close(ThreadPool* pool);
+
+// Queues `fn(arg)` to run on one of the workers. May be called from any thread.
+void pool_submit(ThreadPool* pool, PoolTaskFn fn, void* arg);
+
+#endif // POOL_H
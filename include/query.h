@@ -0,0 +1,53 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lod.h"
+#include "polyline.h"
+
+#define QUERY_NONE ((size_t)-1)
+
+// A series whose x values are non-decreasing, indexed by the min/max pyramid over its y values.
+// The pyramid's `count` is the number of samples. Non-finite y values break the series.
+typedef struct
+{
+    const double* xs;
+    const double* ys;
+    const LodPyramid* lod;
+} QuerySeries;
+
+typedef struct
+{
+    double x;
+    double y;
+} QueryPoint;
+
+typedef struct
+{
+    size_t index;
+    bool maximum;
+} QueryExtremum;
+
+// Finds the sample nearest to the screen point (`screen_x`, `screen_y`) in pixels under `view`,
+// among those less than `radius` pixels away. Blocks of the pyramid whose bounding box is farther
+// than the best sample so far are skipped, so a query near the curve visits O(log N) blocks.
+size_t query_nearest(QuerySeries series, ViewTransform view, double screen_x, double screen_y,
+                     double radius);
+
+// Finds where the lines through the samples of `a` and `b` cross in [min_x, max_x), from left to
+// right. X ranges over which the y extremes of the two series do not overlap are ruled out with
+// the pyramids and halved otherwise; only short ranges are walked sample by sample. Writes at
+// most `max` points and returns how many were written.
+size_t query_intersections(QuerySeries a, QuerySeries b, double min_x, double max_x,
+                           QueryPoint* out, size_t max);
+
+// Finds the local minima and maxima of the samples with x in [min_x, max_x], from left to right:
+// the turning points of a zigzag that ignores swings of `prominence` or less. Each swing, the
+// first one included, costs one O(log N) search of the pyramid. Writes at most `max` extrema and
+// returns how many.
+size_t query_extrema(QuerySeries series, double min_x, double max_x, double prominence,
+                     QueryExtremum* out, size_t max);
+
+#endif // QUERY_H
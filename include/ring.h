@@ -0,0 +1,40 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct
+{
+    double x;
+    double y;
+    double time; // When the producer created the sample, in seconds since the epoch
+} TailSample;
+
+// Lock-free ring buffer with exactly one producer thread and one consumer thread. Each side owns
+// one index and only reads the other's; the producer publishes samples with a release store that
+// the consumer's acquire load pairs with. Neither side ever blocks: a full ring rejects samples.
+typedef struct
+{
+    TailSample* items;
+    size_t mask;
+
+    // On separate cache lines so the two threads do not keep invalidating each other's index
+    alignas(64) atomic_size_t head; // Next slot to write; only the producer stores it
+    size_t cached_tail;
+    alignas(64) atomic_size_t tail; // Next slot to read; only the consumer stores it
+    size_t cached_head;
+} SampleRing;
+
+// `capacity` is rounded up to a power of two
+bool ring_init(SampleRing* ring, size_t capacity);
+void ring_free(SampleRing* ring);
+
+// Producer side. Copies as many of the `count` samples as fit and returns how many that was.
+size_t ring_push(SampleRing* ring, const TailSample* samples, size_t count);
+// Consumer side. Moves up to `max` samples into `out` and returns how many that was.
+size_t ring_pop(SampleRing* ring, TailSample* out, size_t max);
+
+#endif // RING_H
@@ -0,0 +1,80 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "expr.h"
+#include "pool.h"
+
+// Base samples per chunk, chunks cached per curve and how many times a segment may be halved
+#define SAMPLER_CHUNK 256
+#define SAMPLER_CACHE 160
+#define SAMPLER_MAX_DEPTH 4
+
+typedef enum
+{
+    CHUNK_EMPTY,
+    CHUNK_QUEUED,
+    CHUNK_READY,
+} ChunkState;
+
+// Samples of a function over one chunk of a dyadic grid: level `level` has a base step of
+// 2^level and chunk `index` covers [index, index + 1) * SAMPLER_CHUNK * 2^level. Because the
+// grids are nested, a chunk can take half of its base samples from the chunk one level up and
+// all of them from the two chunks one level down. Extra samples are added where the curve bends
+// by more than half a pixel at a y pixel size of 2^y_level.
+typedef struct
+{
+    int level;
+    int y_level;
+    long long index;
+    atomic_int state;
+    unsigned last_used;
+
+    // Written by a worker before it publishes the chunk as ready; read-only afterwards
+    double base[SAMPLER_CHUNK + 1];
+    double* xs;
+    double* ys;
+    size_t count;
+} SampleChunk;
+
+// Samples one function for the current view on a thread pool. Only chunks that are not cached
+// are computed, so a pan evaluates just the newly exposed range and a zoom reuses the samples of
+// the neighbouring levels. The chunks covering the view are stitched into `xs`/`ys` only once
+// all of them are ready, so the renderer never sees a half-computed view.
+typedef struct
+{
+    const Expr* expr;
+    SampleChunk chunks[SAMPLER_CACHE];
+    atomic_int jobs;            // Chunks queued or being computed
+    atomic_size_t evaluations; // Function evaluations so far
+    unsigned frame;
+
+    // What `xs`/`ys` hold, and the last request
+    int level;
+    int y_level;
+    long long first;
+    long long last;
+    bool complete; // The whole prefetch range was ready when it was stitched
+    long long request[4];
+
+    double* xs;
+    double* ys;
+    size_t count;
+    size_t capacity;
+} Sampler;
+
+void sampler_init(Sampler* sampler, const Expr* expr);
+// Waits for the sampler's queued chunks and frees everything
+void sampler_free(Sampler* sampler);
+
+// Requests samples of [min_x, max_x] for a view of `pixel_x` by `pixel_y` world units per pixel,
+// plus half a view on each side. Returns true when `xs`/`ys` were replaced by a complete set of
+// samples for this view; until then they keep the previous one.
+bool sampler_update(Sampler* sampler, ThreadPool* pool, double min_x, double max_x, double pixel_x,
+                    double pixel_y);
+bool sampler_pending(Sampler* sampler);
+
+#endif // SAMPLER_H
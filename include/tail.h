@@ -0,0 +1,37 @@
+#ifndef TAIL_H
+#define TAIL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ring.h"
+
+// Reads a live stream of samples on a background thread and hands them to the render loop
+// through a lock-free ring buffer. The source is standard input ("-") or a local UDP port
+// ("udp:PORT"). Each line holds "y", "x,y" or "x,y,time", where time is when the producer made
+// the sample in seconds since the epoch; without it the time the line was read is used. UDP
+// datagrams may carry several lines.
+typedef struct
+{
+    SampleRing ring;
+    bool udp;
+    long long socket; // Fits both a file descriptor and a Windows SOCKET
+
+    pthread_t thread;
+    bool started;
+    atomic_bool stop;
+    atomic_bool ended; // Standard input reached its end
+
+    atomic_size_t received; // Samples parsed
+    atomic_size_t dropped;  // Samples thrown away because the render loop fell behind
+} Tail;
+
+bool is_tail_source(const char* arg);
+// Opens `source` and starts reading it into a ring of `ring_capacity` samples. Returns false and
+// prints the reason when the source cannot be opened.
+bool tail_start(Tail* tail, const char* source, size_t ring_capacity);
+void tail_close(Tail* tail);
+
+#endif // TAIL_H
@@ -0,0 +1,629 @@
+#include "expr.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NODES 256
+
+typedef enum
+{
+    NODE_NUM,
+    NODE_X,
+    NODE_Y,
+    NODE_UNARY,
+    NODE_BINARY,
+} NodeKind;
+
+typedef struct
+{
+    NodeKind kind;
+    ExprOp op;
+    double value;
+    int lhs;
+    int rhs;
+} Node;
+
+typedef enum
+{
+    TOK_END,
+    TOK_NUM,
+    TOK_X,
+    TOK_Y,
+    TOK_FUNC,
+    TOK_CHAR,
+} TokenKind;
+
+typedef struct
+{
+    TokenKind kind;
+    char ch;
+    double value;
+    ExprOp func;
+    const char* start;
+} Token;
+
+typedef struct
+{
+    const char* source;
+    const char* cur;
+    Token tok;
+
+    Node nodes[MAX_NODES];
+    int nodes_len;
+
+    // Absolute value bars opened and not yet closed, outside of parentheses
+    int bars;
+
+    Expr* expr;
+    bool failed;
+} Parser;
+
+typedef struct
+{
+    const char* name;
+    bool is_func;
+    ExprOp func;
+    double value;
+} Name;
+
+// Longer names come first so that "sinh" is not read as "sin" followed by "h".
+static const Name NAMES[] = {
+    {"asin", true, OP_ASIN, 0},  {"acos", true, OP_ACOS, 0}, {"atan", true, OP_ATAN, 0},
+    {"sinh", true, OP_SINH, 0},  {"cosh", true, OP_COSH, 0}, {"tanh", true, OP_TANH, 0},
+    {"sqrt", true, OP_SQRT, 0},  {"floor", true, OP_FLOOR, 0}, {"ceil", true, OP_CEIL, 0},
+    {"sin", true, OP_SIN, 0},    {"cos", true, OP_COS, 0},   {"tan", true, OP_TAN, 0},
+    {"exp", true, OP_EXP, 0},    {"log", true, OP_LOG, 0},   {"abs", true, OP_ABS, 0},
+    {"ln", true, OP_LN, 0},      {"tau", false, 0, 6.28318530717958647692},
+    {"pi", false, 0, 3.14159265358979323846}, {"e", false, 0, 2.71828182845904523536},
+    {"E", false, 0, 2.71828182845904523536},  {"x", false, 0, 0}, {"y", false, 0, 0},
+};
+
+static void parse_error(Parser* p, const char* fmt, ...)
+{
+    if (p->failed)
+        return;
+    p->failed = true;
+
+    int len = snprintf(p->expr->error, sizeof(p->expr->error), "column %d: ",
+                       (int)(p->tok.start - p->source) + 1);
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(p->expr->error + len, sizeof(p->expr->error) - len, fmt, args);
+    va_end(args);
+}
+
+static void next_token(Parser* p)
+{
+    while (*p->cur == ' ' || *p->cur == '\t')
+        p->cur++;
+
+    Token* tok = &p->tok;
+    tok->start = p->cur;
+    if (*p->cur == '\0') {
+        tok->kind = TOK_END;
+        return;
+    }
+
+    // Digits with at most one point. There is no exponent notation: the e in 2e1 is the constant,
+    // like in 2x1.
+    if ((*p->cur >= '0' && *p->cur <= '9') || *p->cur == '.') {
+        const char* end = p->cur;
+        int points = 0, digits = 0;
+        for (; (*end >= '0' && *end <= '9') || *end == '.'; end++) {
+            if (*end == '.')
+                points++;
+            else
+                digits++;
+        }
+        if (digits == 0) {
+            tok->kind = TOK_CHAR;
+            tok->ch = *p->cur++;
+            return;
+        }
+
+        char text[64];
+        const size_t len = (size_t)(end - p->cur);
+        tok->kind = TOK_NUM;
+        tok->value = 0;
+        if (points > 1) {
+            parse_error(p, "malformed number '%.*s'", (int)len, p->cur);
+        } else if (len >= sizeof(text)) {
+            parse_error(p, "number too long");
+        } else {
+            memcpy(text, p->cur, len);
+            text[len] = '\0';
+            tok->value = strtod(text, NULL);
+        }
+        p->cur = end;
+        return;
+    }
+
+    if ((*p->cur >= 'a' && *p->cur <= 'z') || (*p->cur >= 'A' && *p->cur <= 'Z')) {
+        for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+            size_t len = strlen(NAMES[i].name);
+            if (strncmp(p->cur, NAMES[i].name, len) != 0)
+                continue;
+
+            p->cur += len;
+            if (NAMES[i].is_func) {
+                tok->kind = TOK_FUNC;
+                tok->func = NAMES[i].func;
+            } else if (strcmp(NAMES[i].name, "x") == 0) {
+                tok->kind = TOK_X;
+            } else if (strcmp(NAMES[i].name, "y") == 0) {
+                tok->kind = TOK_Y;
+            } else {
+                tok->kind = TOK_NUM;
+                tok->value = NAMES[i].value;
+            }
+            return;
+        }
+        tok->kind = TOK_CHAR;
+        tok->ch = *p->cur;
+        parse_error(p, "unknown identifier '%c'", *p->cur);
+        p->cur++;
+        return;
+    }
+
+    tok->kind = TOK_CHAR;
+    tok->ch = *p->cur++;
+}
+
+static bool accept_char(Parser* p, char ch)
+{
+    if (p->tok.kind == TOK_CHAR && p->tok.ch == ch) {
+        next_token(p);
+        return true;
+    }
+    return false;
+}
+
+static void expect_char(Parser* p, char ch)
+{
+    if (!accept_char(p, ch))
+        parse_error(p, "expected '%c'", ch);
+}
+
+static double apply_op(ExprOp op, double a, double b)
+{
+    switch (op) {
+    case OP_ADD: return a + b;
+    case OP_SUB: return a - b;
+    case OP_MUL: return a * b;
+    case OP_DIV: return a / b;
+    case OP_POW: return pow(a, b);
+    case OP_NEG: return -a;
+    case OP_SIN: return sin(a);
+    case OP_COS: return cos(a);
+    case OP_TAN: return tan(a);
+    case OP_ASIN: return asin(a);
+    case OP_ACOS: return acos(a);
+    case OP_ATAN: return atan(a);
+    case OP_SINH: return sinh(a);
+    case OP_COSH: return cosh(a);
+    case OP_TANH: return tanh(a);
+    case OP_EXP: return exp(a);
+    case OP_LN: return log(a);
+    case OP_LOG: return log10(a);
+    case OP_SQRT: return sqrt(a);
+    case OP_ABS: return fabs(a);
+    case OP_FLOOR: return floor(a);
+    case OP_CEIL: return ceil(a);
+    default: return NAN;
+    }
+}
+
+static int new_node(Parser* p, NodeKind kind, ExprOp op, double value, int lhs, int rhs)
+{
+    if (p->failed)
+        return 0;
+    if (p->nodes_len >= MAX_NODES) {
+        parse_error(p, "expression is too long");
+        return 0;
+    }
+
+    // Fold operations on constants as the tree is built
+    if (kind == NODE_UNARY && p->nodes[lhs].kind == NODE_NUM) {
+        kind = NODE_NUM;
+        value = apply_op(op, p->nodes[lhs].value, 0);
+    } else if (kind == NODE_BINARY && p->nodes[lhs].kind == NODE_NUM &&
+               p->nodes[rhs].kind == NODE_NUM) {
+        kind = NODE_NUM;
+        value = apply_op(op, p->nodes[lhs].value, p->nodes[rhs].value);
+    }
+
+    p->nodes[p->nodes_len] = (Node){kind, op, value, lhs, rhs};
+    return p->nodes_len++;
+}
+
+static int parse_expr(Parser* p, int min_prec);
+
+// The inside of parentheses, whose '(' was just read. A '|' in there opens a new bar.
+static int parse_parens(Parser* p)
+{
+    const int bars = p->bars;
+    p->bars = 0;
+    int inner = parse_expr(p, 0);
+    p->bars = bars;
+    expect_char(p, ')');
+    return inner;
+}
+
+static int parse_primary(Parser* p)
+{
+    if (p->failed)
+        return 0;
+
+    Token tok = p->tok;
+    switch (tok.kind) {
+    case TOK_NUM:
+        next_token(p);
+        return new_node(p, NODE_NUM, 0, tok.value, -1, -1);
+    case TOK_X:
+        next_token(p);
+        return new_node(p, NODE_X, 0, 0, -1, -1);
+    case TOK_Y:
+        next_token(p);
+        return new_node(p, NODE_Y, 0, 0, -1, -1);
+    case TOK_FUNC: {
+        next_token(p);
+        int arg;
+        if (accept_char(p, '(')) {
+            arg = parse_parens(p);
+        } else {
+            // Desmos accepts "sin x"; the argument binds like a power
+            arg = parse_expr(p, 3);
+        }
+        return new_node(p, NODE_UNARY, tok.func, 0, arg, -1);
+    }
+    case TOK_CHAR:
+        if (accept_char(p, '('))
+            return parse_parens(p);
+        if (accept_char(p, '|')) {
+            p->bars++;
+            int inner = parse_expr(p, 0);
+            p->bars--;
+            expect_char(p, '|');
+            return new_node(p, NODE_UNARY, OP_ABS, 0, inner, -1);
+        }
+        parse_error(p, "unexpected '%c'", tok.ch);
+        return 0;
+    case TOK_END:
+    default:
+        parse_error(p, "unexpected end of expression");
+        return 0;
+    }
+}
+
+static int parse_unary(Parser* p)
+{
+    if (accept_char(p, '-'))
+        return new_node(p, NODE_UNARY, OP_NEG, 0, parse_expr(p, 3), -1);
+    if (accept_char(p, '+'))
+        return parse_expr(p, 3);
+    return parse_primary(p);
+}
+
+// A '|' inside an open bar closes it, so only outside of one does it start "2|x|"
+static bool starts_operand(const Parser* p)
+{
+    const Token* tok = &p->tok;
+    return tok->kind == TOK_NUM || tok->kind == TOK_X || tok->kind == TOK_Y ||
+           tok->kind == TOK_FUNC ||
+           (tok->kind == TOK_CHAR && (tok->ch == '(' || (tok->ch == '|' && p->bars == 0)));
+}
+
+// Precedence climbing: + - (1), * / and implicit multiplication (2), unary minus (3), ^ (4)
+static int parse_expr(Parser* p, int min_prec)
+{
+    int lhs = parse_unary(p);
+    while (!p->failed) {
+        ExprOp op;
+        int prec;
+        bool implicit = false;
+
+        if (p->tok.kind == TOK_CHAR && p->tok.ch == '+') {
+            op = OP_ADD, prec = 1;
+        } else if (p->tok.kind == TOK_CHAR && p->tok.ch == '-') {
+            op = OP_SUB, prec = 1;
+        } else if (p->tok.kind == TOK_CHAR && p->tok.ch == '*') {
+            op = OP_MUL, prec = 2;
+        } else if (p->tok.kind == TOK_CHAR && p->tok.ch == '/') {
+            op = OP_DIV, prec = 2;
+        } else if (p->tok.kind == TOK_CHAR && p->tok.ch == '^') {
+            op = OP_POW, prec = 4;
+        } else if (starts_operand(p)) {
+            op = OP_MUL, prec = 2, implicit = true;
+        } else {
+            break;
+        }
+
+        if (prec < min_prec)
+            break;
+        if (!implicit)
+            next_token(p);
+
+        // ^ is right associative, everything else is left associative
+        int rhs = op == OP_POW ? parse_expr(p, prec) : parse_expr(p, prec + 1);
+        lhs = new_node(p, NODE_BINARY, op, 0, lhs, rhs);
+    }
+    return lhs;
+}
+
+static int add_const(Parser* p, double value)
+{
+    Expr* e = p->expr;
+    for (int i = 0; i < e->consts_len; i++) {
+        if (memcmp(&e->consts[i], &value, sizeof(value)) == 0)
+            return i;
+    }
+    if (e->consts_len >= EXPR_MAX_CONSTS) {
+        parse_error(p, "too many constants");
+        return 0;
+    }
+    e->consts[e->consts_len] = value;
+    return e->consts_len++;
+}
+
+static void emit(Parser* p, ExprOp op, int dst, int a, int b)
+{
+    Expr* e = p->expr;
+    if (e->code_len >= EXPR_MAX_CODE) {
+        parse_error(p, "expression is too long");
+        return;
+    }
+    if (dst >= EXPR_MAX_REGS) {
+        parse_error(p, "expression is nested too deeply");
+        return;
+    }
+    e->code[e->code_len++] = (ExprInstr){op, dst, a, b};
+    if (dst + 1 > e->regs_used)
+        e->regs_used = dst + 1;
+}
+
+// Number of registers needed to evaluate a subtree (Sethi-Ullman numbering)
+static int regs_needed(const Parser* p, int n)
+{
+    const Node* node = &p->nodes[n];
+    if (node->kind == NODE_UNARY)
+        return regs_needed(p, node->lhs);
+    if (node->kind != NODE_BINARY)
+        return 1;
+
+    if (p->nodes[node->rhs].kind == NODE_NUM)
+        return regs_needed(p, node->lhs);
+    if (p->nodes[node->lhs].kind == NODE_NUM)
+        return regs_needed(p, node->rhs);
+
+    int l = regs_needed(p, node->lhs);
+    int r = regs_needed(p, node->rhs);
+    return l == r ? l + 1 : (l > r ? l : r);
+}
+
+// Generates code leaving the value of node `n` in register `dst`, using only registers >= dst
+static void gen(Parser* p, int n, int dst)
+{
+    const Node* node = &p->nodes[n];
+    const Node* lhs = node->lhs >= 0 ? &p->nodes[node->lhs] : NULL;
+    const Node* rhs = node->rhs >= 0 ? &p->nodes[node->rhs] : NULL;
+
+    switch (node->kind) {
+    case NODE_NUM:
+        emit(p, OP_CONST, dst, 0, add_const(p, node->value));
+        return;
+    case NODE_X:
+        emit(p, OP_X, dst, 0, 0);
+        return;
+    case NODE_Y:
+        emit(p, OP_Y, dst, 0, 0);
+        return;
+    case NODE_UNARY:
+        gen(p, node->lhs, dst);
+        emit(p, node->op, dst, dst, 0);
+        return;
+    case NODE_BINARY:
+        break;
+    }
+
+    if (rhs->kind == NODE_NUM) {
+        double k = rhs->value;
+        gen(p, node->lhs, dst);
+        switch (node->op) {
+        case OP_ADD: emit(p, OP_ADDK, dst, dst, add_const(p, k)); break;
+        case OP_SUB: emit(p, OP_SUBK, dst, dst, add_const(p, k)); break;
+        case OP_MUL: emit(p, OP_MULK, dst, dst, add_const(p, k)); break;
+        case OP_DIV: emit(p, OP_DIVK, dst, dst, add_const(p, k)); break;
+        case OP_POW:
+            if (k == 2.0)
+                emit(p, OP_SQR, dst, dst, 0);
+            else if (k != 1.0)
+                emit(p, OP_POWK, dst, dst, add_const(p, k));
+            break;
+        default: break;
+        }
+        return;
+    }
+
+    if (lhs->kind == NODE_NUM) {
+        double k = lhs->value;
+        gen(p, node->rhs, dst);
+        switch (node->op) {
+        case OP_ADD: emit(p, OP_ADDK, dst, dst, add_const(p, k)); break;
+        case OP_SUB: emit(p, OP_KSUB, dst, dst, add_const(p, k)); break;
+        case OP_MUL: emit(p, OP_MULK, dst, dst, add_const(p, k)); break;
+        case OP_DIV: emit(p, OP_KDIV, dst, dst, add_const(p, k)); break;
+        case OP_POW: emit(p, OP_KPOW, dst, dst, add_const(p, k)); break;
+        default: break;
+        }
+        return;
+    }
+
+    // Evaluate the subtree that needs more registers first so the other one can use fewer
+    if (regs_needed(p, node->rhs) > regs_needed(p, node->lhs)) {
+        gen(p, node->rhs, dst);
+        gen(p, node->lhs, dst + 1);
+        emit(p, node->op, dst, dst + 1, dst);
+    } else {
+        gen(p, node->lhs, dst);
+        gen(p, node->rhs, dst + 1);
+        emit(p, node->op, dst, dst, dst + 1);
+    }
+}
+
+static bool uses_y(const Parser* p, int n)
+{
+    const Node* node = &p->nodes[n];
+    switch (node->kind) {
+    case NODE_Y: return true;
+    case NODE_UNARY: return uses_y(p, node->lhs);
+    case NODE_BINARY: return uses_y(p, node->lhs) || uses_y(p, node->rhs);
+    default: return false;
+    }
+}
+
+// Parses `lhs = rhs`, `lhs < rhs` and the like. "y = f(x)" and a bare f(x) are explicit curves;
+// anything else is turned into lhs - rhs or rhs - lhs.
+static int parse_relation(Parser* p)
+{
+    const int lhs = parse_expr(p, 0);
+    char relation = '\0';
+    bool or_equal = false;
+    if (p->tok.kind == TOK_CHAR && (p->tok.ch == '=' || p->tok.ch == '<' || p->tok.ch == '>')) {
+        relation = p->tok.ch;
+        next_token(p);
+        or_equal = relation != '=' && accept_char(p, '=');
+    }
+    if (p->failed)
+        return 0;
+    if (relation == '\0') {
+        if (uses_y(p, lhs))
+            parse_error(p, "expected '=', '<' or '>'");
+        p->expr->relation = EXPR_EXPLICIT;
+        return lhs;
+    }
+
+    const int rhs = parse_expr(p, 0);
+    if (p->failed)
+        return 0;
+    if (relation == '=' && p->nodes[lhs].kind == NODE_Y && !uses_y(p, rhs)) {
+        p->expr->relation = EXPR_EXPLICIT;
+        return rhs;
+    }
+    if (relation == '=')
+        p->expr->relation = EXPR_EQUAL;
+    else
+        p->expr->relation = or_equal ? EXPR_LESS_EQUAL : EXPR_LESS;
+    return relation == '>' ? new_node(p, NODE_BINARY, OP_SUB, 0, rhs, lhs)
+                           : new_node(p, NODE_BINARY, OP_SUB, 0, lhs, rhs);
+}
+
+bool expr_compile(Expr* expr, const char* source)
+{
+    memset(expr, 0, sizeof(*expr));
+
+    Parser* p = calloc(1, sizeof(Parser));
+    p->source = source;
+    p->cur = source;
+    p->expr = expr;
+    next_token(p);
+
+    int root = parse_relation(p);
+    if (!p->failed && p->tok.kind != TOK_END) {
+        if (p->tok.kind == TOK_CHAR)
+            parse_error(p, "unexpected '%c'", p->tok.ch);
+        else
+            parse_error(p, "unexpected input");
+    }
+    if (!p->failed) {
+        gen(p, root, 0);
+        expr->result = 0;
+    }
+
+    bool ok = !p->failed;
+    free(p);
+    return ok;
+}
+
+#define FOR_LANES(value)                                                                           \
+    for (size_t i = 0; i < n; i++) {                                                               \
+        d[i] = (value);                                                                            \
+    }
+
+static void eval_batch(const Expr* e, const double* xs, const double* ys, double* values,
+                       size_t n, double regs[][EXPR_LANES])
+{
+    for (int pc = 0; pc < e->code_len; pc++) {
+        const ExprInstr in = e->code[pc];
+        double* d = regs[in.dst];
+        const double* a = regs[in.a];
+        const double* b = regs[in.b];
+        const double k = e->consts[in.b];
+
+        switch ((ExprOp)in.op) {
+        case OP_X: memcpy(d, xs, n * sizeof(double)); break;
+        case OP_Y: memcpy(d, ys, n * sizeof(double)); break;
+        case OP_CONST: FOR_LANES(k); break;
+        case OP_ADD: FOR_LANES(a[i] + b[i]); break;
+        case OP_SUB: FOR_LANES(a[i] - b[i]); break;
+        case OP_MUL: FOR_LANES(a[i] * b[i]); break;
+        case OP_DIV: FOR_LANES(a[i] / b[i]); break;
+        case OP_POW: FOR_LANES(pow(a[i], b[i])); break;
+        case OP_ADDK: FOR_LANES(a[i] + k); break;
+        case OP_SUBK: FOR_LANES(a[i] - k); break;
+        case OP_KSUB: FOR_LANES(k - a[i]); break;
+        case OP_MULK: FOR_LANES(a[i] * k); break;
+        case OP_DIVK: FOR_LANES(a[i] / k); break;
+        case OP_KDIV: FOR_LANES(k / a[i]); break;
+        case OP_POWK: FOR_LANES(pow(a[i], k)); break;
+        case OP_KPOW: FOR_LANES(pow(k, a[i])); break;
+        case OP_NEG: FOR_LANES(-a[i]); break;
+        case OP_SQR: FOR_LANES(a[i] * a[i]); break;
+        case OP_SIN: FOR_LANES(sin(a[i])); break;
+        case OP_COS: FOR_LANES(cos(a[i])); break;
+        case OP_TAN: FOR_LANES(tan(a[i])); break;
+        case OP_ASIN: FOR_LANES(asin(a[i])); break;
+        case OP_ACOS: FOR_LANES(acos(a[i])); break;
+        case OP_ATAN: FOR_LANES(atan(a[i])); break;
+        case OP_SINH: FOR_LANES(sinh(a[i])); break;
+        case OP_COSH: FOR_LANES(cosh(a[i])); break;
+        case OP_TANH: FOR_LANES(tanh(a[i])); break;
+        case OP_EXP: FOR_LANES(exp(a[i])); break;
+        case OP_LN: FOR_LANES(log(a[i])); break;
+        case OP_LOG: FOR_LANES(log10(a[i])); break;
+        case OP_SQRT: FOR_LANES(sqrt(a[i])); break;
+        case OP_ABS: FOR_LANES(fabs(a[i])); break;
+        case OP_FLOOR: FOR_LANES(floor(a[i])); break;
+        case OP_CEIL: FOR_LANES(ceil(a[i])); break;
+        }
+    }
+    memcpy(values, regs[e->result], n * sizeof(double));
+}
+
+void expr_eval(const Expr* expr, const double* xs, double* ys, size_t count)
+{
+    double regs[EXPR_MAX_REGS][EXPR_LANES];
+    for (size_t i = 0; i < count; i += EXPR_LANES) {
+        size_t n = count - i < EXPR_LANES ? count - i : EXPR_LANES;
+        eval_batch(expr, xs + i, NULL, ys + i, n, regs);
+    }
+}
+
+void expr_eval_xy(const Expr* expr, const double* xs, const double* ys, double* values,
+                  size_t count)
+{
+    double regs[EXPR_MAX_REGS][EXPR_LANES];
+    for (size_t i = 0; i < count; i += EXPR_LANES) {
+        size_t n = count - i < EXPR_LANES ? count - i : EXPR_LANES;
+        eval_batch(expr, xs + i, ys + i, values + i, n, regs);
+    }
+}
+
+double expr_eval_scalar(const Expr* expr, double x)
+{
+    double y;
+    expr_eval(expr, &x, &y, 1);
+    return y;
+}
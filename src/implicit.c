@@ -0,0 +1,585 @@
+#include "implicit.h"
+
+#include <math.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "interval.h"
+
+#define CORNERS (IMPLICIT_TILE + 1)
+// Cell edges of a tile are numbered horizontal ones first, then vertical ones
+#define HORIZONTAL_EDGES (IMPLICIT_TILE * CORNERS)
+#define NO_EDGE UINT32_MAX
+
+typedef struct
+{
+    Implicit* implicit;
+    ImplicitTile* tile;
+} TileJob;
+
+// A single cell the quadtree could not rule out
+typedef struct
+{
+    int x, y;
+    bool bounded; // The interval over the cell is finite, so a sign change there is a crossing
+} Leaf;
+
+typedef struct
+{
+    double x[2], y[2];
+    uint32_t edge[2];
+} ContourSegment;
+
+// Everything one worker builds for a tile
+typedef struct
+{
+    const Expr* expr;
+    bool fill;
+    long long first_x; // Cell index of the tile's lower left corner
+    long long first_y;
+    double cell_x;
+    double cell_y;
+    size_t intervals;
+
+    Leaf* leaves;
+    size_t num_of_leaves, leaves_capacity;
+    ContourSegment* segments;
+    size_t num_of_segments, segments_capacity;
+    double* triangles;
+    size_t triangle_count, triangle_capacity;
+} TileBuild;
+
+static void* grow(void* items, size_t* capacity, size_t needed, size_t size)
+{
+    if (needed <= *capacity)
+        return items;
+    *capacity = needed > 2 * *capacity ? needed : 2 * *capacity;
+    return realloc(items, *capacity * size);
+}
+
+// Cell corners are integers times a power of two, so they are exact and tiles meet without gaps
+static double corner_x(const TileBuild* b, int x)
+{
+    return (double)(b->first_x + x) * b->cell_x;
+}
+
+static double corner_y(const TileBuild* b, int y)
+{
+    return (double)(b->first_y + y) * b->cell_y;
+}
+
+static void add_vertex(TileBuild* b, double x, double y)
+{
+    b->triangles = grow(b->triangles, &b->triangle_capacity, 2 * (b->triangle_count + 1),
+                        sizeof(double));
+    b->triangles[2 * b->triangle_count] = x;
+    b->triangles[2 * b->triangle_count + 1] = y;
+    b->triangle_count++;
+}
+
+static void add_rect(TileBuild* b, double x0, double y0, double x1, double y1)
+{
+    add_vertex(b, x0, y0);
+    add_vertex(b, x1, y0);
+    add_vertex(b, x1, y1);
+    add_vertex(b, x0, y0);
+    add_vertex(b, x1, y1);
+    add_vertex(b, x0, y1);
+}
+
+// Bounds the relation over the box of `size` cells at (`x`, `y`). A box that cannot hold a zero
+// is dropped, or filled when it lies inside an inequality; otherwise it is split down to cells.
+static void subdivide(TileBuild* b, int x, int y, int size)
+{
+    const Interval box_x = {corner_x(b, x), corner_x(b, x + size)};
+    const Interval box_y = {corner_y(b, y), corner_y(b, y + size)};
+    const Interval value = interval_eval(b->expr, box_x, box_y);
+    b->intervals++;
+    if (interval_empty(value) || value.lo > 0)
+        return;
+    if (value.hi < 0) {
+        if (b->fill)
+            add_rect(b, box_x.lo, box_y.lo, box_x.hi, box_y.hi);
+        return;
+    }
+
+    if (size == 1) {
+        b->leaves = grow(b->leaves, &b->leaves_capacity, b->num_of_leaves + 1, sizeof(Leaf));
+        b->leaves[b->num_of_leaves++] =
+            (Leaf){x, y, isfinite(value.lo) && isfinite(value.hi)};
+        return;
+    }
+    const int half = size / 2;
+    subdivide(b, x, y, half);
+    subdivide(b, x + half, y, half);
+    subdivide(b, x, y + half, half);
+    subdivide(b, x + half, y + half, half);
+}
+
+static void add_segment(TileBuild* b, const double* xs, const double* ys, const uint32_t* edges,
+                        int from, int to)
+{
+    b->segments = grow(b->segments, &b->segments_capacity, b->num_of_segments + 1,
+                       sizeof(ContourSegment));
+    b->segments[b->num_of_segments++] =
+        (ContourSegment){{xs[from], xs[to]}, {ys[from], ys[to]}, {edges[from], edges[to]}};
+}
+
+// Marching squares on one cell. Corners go counterclockwise from the lower left, and edge k
+// runs from corner k to corner k + 1.
+static void march(TileBuild* b, const Leaf leaf, const double* values)
+{
+    const int x = leaf.x, y = leaf.y;
+    const double v[4] = {values[y * CORNERS + x], values[y * CORNERS + x + 1],
+                         values[(y + 1) * CORNERS + x + 1], values[(y + 1) * CORNERS + x]};
+    const double px[4] = {corner_x(b, x), corner_x(b, x + 1), corner_x(b, x + 1), corner_x(b, x)};
+    const double py[4] = {corner_y(b, y), corner_y(b, y), corner_y(b, y + 1), corner_y(b, y + 1)};
+    const uint32_t edges[4] = {
+        (uint32_t)(y * IMPLICIT_TILE + x),
+        (uint32_t)(HORIZONTAL_EDGES + y * CORNERS + x + 1),
+        (uint32_t)((y + 1) * IMPLICIT_TILE + x),
+        (uint32_t)(HORIZONTAL_EDGES + y * CORNERS + x),
+    };
+
+    bool inside[4];
+    int mask = 0;
+    for (int k = 0; k < 4; k++) {
+        inside[k] = v[k] < 0;
+        mask |= inside[k] << k;
+    }
+    if (mask == 0)
+        return;
+    if (mask == 15) {
+        if (b->fill)
+            add_rect(b, px[0], py[0], px[2], py[2]);
+        return;
+    }
+
+    // Where the relation crosses zero on each edge, interpolated from the corner with the lower
+    // coordinates so that both cells sharing an edge find the same point
+    double ex[4], ey[4];
+    for (int k = 0; k < 4; k++) {
+        const int from = k < 2 ? k : (k + 1) % 4, to = k < 2 ? k + 1 : k;
+        double t = v[from] / (v[from] - v[to]);
+        if (!(t >= 0 && t <= 1))
+            t = 0.5;
+        ex[k] = px[from] + t * (px[to] - px[from]);
+        ey[k] = py[from] + t * (py[to] - py[from]);
+    }
+
+    // At a saddle the mean of the corners decides whether the inside corners are connected
+    const bool saddle = mask == 5 || mask == 10;
+    const bool center = (v[0] + v[1] + v[2] + v[3]) / 4 < 0;
+
+    // A sign change across a pole, where the bounds are infinite, is not a crossing
+    if (leaf.bounded && isfinite(v[0]) && isfinite(v[1]) && isfinite(v[2]) && isfinite(v[3])) {
+        if (saddle) {
+            for (int k = 0; k < 4; k++) {
+                if (inside[k] != center)
+                    add_segment(b, ex, ey, edges, (k + 3) % 4, k);
+            }
+        } else {
+            int crossed[2], n = 0;
+            for (int k = 0; k < 4; k++) {
+                if (inside[k] != inside[(k + 1) % 4])
+                    crossed[n++] = k;
+            }
+            add_segment(b, ex, ey, edges, crossed[0], crossed[1]);
+        }
+    }
+    if (!b->fill)
+        return;
+
+    if (saddle && !center) {
+        for (int k = 0; k < 4; k++) {
+            if (!inside[k])
+                continue;
+            add_vertex(b, ex[(k + 3) % 4], ey[(k + 3) % 4]);
+            add_vertex(b, px[k], py[k]);
+            add_vertex(b, ex[k], ey[k]);
+        }
+        return;
+    }
+    // The inside part of the cell is convex, so it is drawn as a fan
+    double qx[8], qy[8];
+    int n = 0;
+    for (int k = 0; k < 4; k++) {
+        if (inside[k])
+            qx[n] = px[k], qy[n++] = py[k];
+        if (inside[k] != inside[(k + 1) % 4])
+            qx[n] = ex[k], qy[n++] = ey[k];
+    }
+    for (int i = 1; i + 1 < n; i++) {
+        add_vertex(b, qx[0], qy[0]);
+        add_vertex(b, qx[i], qy[i]);
+        add_vertex(b, qx[i + 1], qy[i + 1]);
+    }
+}
+
+typedef struct
+{
+    uint32_t edge;
+    int32_t ends[2]; // Segment index times two plus the end
+} EdgeSlot;
+
+static EdgeSlot* find_edge(EdgeSlot* slots, size_t mask, uint32_t edge)
+{
+    size_t i = (edge * 2654435761u) & mask;
+    while (slots[i].edge != edge && slots[i].edge != NO_EDGE)
+        i = (i + 1) & mask;
+    return &slots[i];
+}
+
+// The end of another segment on the same cell edge as `end`, or -1
+static int32_t partner(EdgeSlot* slots, size_t mask, const ContourSegment* segments, int32_t end)
+{
+    const EdgeSlot* slot = find_edge(slots, mask, segments[end / 2].edge[end % 2]);
+    return slot->ends[0] == end ? slot->ends[1] : slot->ends[0];
+}
+
+// Joins the segments of neighbouring cells into lines, so the renderer draws joins between them
+// and each crossing is stored once
+static void chain(TileBuild* b, ImplicitTile* tile)
+{
+    const size_t n = b->num_of_segments;
+    if (n == 0)
+        return;
+
+    size_t size = 1;
+    while (size < 4 * n)
+        size *= 2;
+    EdgeSlot* slots = malloc(size * sizeof(EdgeSlot));
+    for (size_t i = 0; i < size; i++)
+        slots[i] = (EdgeSlot){NO_EDGE, {-1, -1}};
+    for (size_t i = 0; i < n; i++) {
+        for (int end = 0; end < 2; end++) {
+            EdgeSlot* slot = find_edge(slots, size - 1, b->segments[i].edge[end]);
+            slot->edge = b->segments[i].edge[end];
+            slot->ends[slot->ends[0] < 0 ? 0 : 1] = (int32_t)(2 * i + end);
+        }
+    }
+
+    bool* visited = calloc(n, sizeof(bool));
+    tile->xs = malloc(3 * n * sizeof(double));
+    tile->ys = malloc(3 * n * sizeof(double));
+    size_t count = 0;
+    for (size_t first = 0; first < n; first++) {
+        if (visited[first])
+            continue;
+
+        // Walk back to the free end of the line, or once around a closed loop
+        int32_t start = (int32_t)(2 * first);
+        for (size_t steps = 0; steps < n; steps++) {
+            const int32_t other = partner(slots, size - 1, b->segments, start);
+            if (other < 0 || (size_t)(other / 2) == first)
+                break;
+            start = other ^ 1;
+        }
+
+        const ContourSegment* s = &b->segments[start / 2];
+        tile->xs[count] = s->x[start % 2];
+        tile->ys[count++] = s->y[start % 2];
+        for (;;) {
+            s = &b->segments[start / 2];
+            visited[start / 2] = true;
+            const int32_t end = start ^ 1;
+            tile->xs[count] = s->x[end % 2];
+            tile->ys[count++] = s->y[end % 2];
+
+            const int32_t next = partner(slots, size - 1, b->segments, end);
+            if (next < 0 || visited[next / 2])
+                break;
+            start = next;
+        }
+        tile->xs[count] = NAN;
+        tile->ys[count++] = NAN;
+    }
+    tile->count = count;
+    free(visited);
+    free(slots);
+}
+
+static void sample_tile(void* arg)
+{
+    TileJob* job = arg;
+    Implicit* implicit = job->implicit;
+    ImplicitTile* tile = job->tile;
+    free(job);
+
+    TileBuild b = {0};
+    b.expr = implicit->expr;
+    b.fill = implicit->expr->relation != EXPR_EQUAL;
+    b.first_x = tile->ix * IMPLICIT_TILE;
+    b.first_y = tile->iy * IMPLICIT_TILE;
+    b.cell_x = ldexp(1.0, tile->level_x);
+    b.cell_y = ldexp(1.0, tile->level_y);
+    subdivide(&b, 0, 0, IMPLICIT_TILE);
+
+    // Corners of the cells left over, each evaluated once even when cells share it
+    bool* needed = calloc(CORNERS * CORNERS, sizeof(bool));
+    uint32_t* corners = malloc((4 * b.num_of_leaves + 1) * sizeof(uint32_t));
+    size_t num_of_corners = 0;
+    for (size_t i = 0; i < b.num_of_leaves; i++) {
+        for (int k = 0; k < 4; k++) {
+            const uint32_t corner =
+                (uint32_t)((b.leaves[i].y + k / 2) * CORNERS + b.leaves[i].x + k % 2);
+            if (!needed[corner]) {
+                needed[corner] = true;
+                corners[num_of_corners++] = corner;
+            }
+        }
+    }
+    double* xs = malloc((num_of_corners + 1) * sizeof(double));
+    double* ys = malloc((num_of_corners + 1) * sizeof(double));
+    double* corner_values = malloc((num_of_corners + 1) * sizeof(double));
+    for (size_t i = 0; i < num_of_corners; i++) {
+        xs[i] = corner_x(&b, (int)(corners[i] % CORNERS));
+        ys[i] = corner_y(&b, (int)(corners[i] / CORNERS));
+    }
+    expr_eval_xy(b.expr, xs, ys, corner_values, num_of_corners);
+
+    double* values = malloc(CORNERS * CORNERS * sizeof(double));
+    for (size_t i = 0; i < num_of_corners; i++)
+        values[corners[i]] = corner_values[i];
+    for (size_t i = 0; i < b.num_of_leaves; i++)
+        march(&b, b.leaves[i], values);
+    chain(&b, tile);
+    tile->triangles = b.triangles;
+    tile->triangle_count = b.triangle_count;
+
+    free(values);
+    free(corner_values);
+    free(xs);
+    free(ys);
+    free(corners);
+    free(needed);
+    free(b.leaves);
+    free(b.segments);
+
+    atomic_fetch_add_explicit(&implicit->interval_evaluations, b.intervals,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&implicit->point_evaluations, num_of_corners,
+                              memory_order_relaxed);
+    atomic_store_explicit(&tile->state, CHUNK_READY, memory_order_release);
+    atomic_fetch_sub_explicit(&implicit->jobs, 1, memory_order_release);
+}
+
+void implicit_init(Implicit* implicit, const Expr* expr)
+{
+    memset(implicit, 0, sizeof(*implicit));
+    implicit->expr = expr;
+    for (int i = 0; i < IMPLICIT_CACHE; i++)
+        atomic_init(&implicit->tiles[i].state, CHUNK_EMPTY);
+    atomic_init(&implicit->jobs, 0);
+    atomic_init(&implicit->interval_evaluations, 0);
+    atomic_init(&implicit->point_evaluations, 0);
+    implicit->covered[0] = implicit->covered[2] = 1;
+}
+
+static void tile_clear(ImplicitTile* tile)
+{
+    free(tile->xs);
+    free(tile->ys);
+    free(tile->triangles);
+    tile->xs = tile->ys = tile->triangles = NULL;
+    tile->count = tile->triangle_count = 0;
+}
+
+void implicit_free(Implicit* implicit)
+{
+    while (atomic_load_explicit(&implicit->jobs, memory_order_acquire) > 0)
+        sched_yield();
+    for (int i = 0; i < IMPLICIT_CACHE; i++)
+        tile_clear(&implicit->tiles[i]);
+    free(implicit->xs);
+    free(implicit->ys);
+    free(implicit->triangles);
+    memset(implicit, 0, sizeof(*implicit));
+}
+
+bool implicit_pending(Implicit* implicit)
+{
+    return atomic_load_explicit(&implicit->jobs, memory_order_acquire) > 0;
+}
+
+// A range of tiles, first and last in x, then in y
+typedef struct
+{
+    long long first_x, last_x, first_y, last_y;
+} TileRange;
+
+static long long range_size(TileRange r)
+{
+    return (r.last_x - r.first_x + 1) * (r.last_y - r.first_y + 1);
+}
+
+// An unused slot, or the least recently used ready tile that the current request does not need
+static ImplicitTile* evict(Implicit* implicit)
+{
+    ImplicitTile* oldest = NULL;
+    for (int i = 0; i < IMPLICIT_CACHE; i++) {
+        ImplicitTile* tile = &implicit->tiles[i];
+        const int state = atomic_load_explicit(&tile->state, memory_order_acquire);
+        if (state == CHUNK_EMPTY)
+            return tile;
+        if (state == CHUNK_READY && tile->last_used != implicit->frame &&
+            (oldest == NULL || tile->last_used < oldest->last_used))
+            oldest = tile;
+    }
+    if (oldest != NULL)
+        tile_clear(oldest);
+    return oldest;
+}
+
+static void request(Implicit* implicit, ThreadPool* pool, ImplicitTile** slot, int level_x,
+                    int level_y, long long ix, long long iy)
+{
+    if (*slot != NULL)
+        return;
+    ImplicitTile* tile = evict(implicit);
+    if (tile == NULL)
+        return;
+
+    tile->level_x = level_x;
+    tile->level_y = level_y;
+    tile->ix = ix;
+    tile->iy = iy;
+    tile->last_used = implicit->frame;
+    atomic_store_explicit(&tile->state, CHUNK_QUEUED, memory_order_relaxed);
+    *slot = tile;
+
+    TileJob* job = malloc(sizeof(TileJob));
+    job->implicit = implicit;
+    job->tile = tile;
+    atomic_fetch_add_explicit(&implicit->jobs, 1, memory_order_relaxed);
+    pool_submit(pool, sample_tile, job);
+}
+
+static bool is_ready(const ImplicitTile* tile)
+{
+    return tile != NULL && atomic_load_explicit(&tile->state, memory_order_acquire) == CHUNK_READY;
+}
+
+// Concatenates the lines and triangles of the tiles in `r`, a part of the request `range`
+static void stitch(Implicit* implicit, ImplicitTile** current, TileRange range, TileRange r)
+{
+    const long long width = range.last_x - range.first_x + 1;
+    size_t count = 0, triangle_count = 0;
+    for (long long iy = r.first_y; iy <= r.last_y; iy++) {
+        for (long long ix = r.first_x; ix <= r.last_x; ix++) {
+            const ImplicitTile* tile =
+                current[(iy - range.first_y) * width + (ix - range.first_x)];
+            count += tile->count;
+            triangle_count += tile->triangle_count;
+        }
+    }
+    if (count > implicit->capacity) {
+        implicit->xs = realloc(implicit->xs, count * sizeof(double));
+        implicit->ys = realloc(implicit->ys, count * sizeof(double));
+        implicit->capacity = count;
+    }
+    implicit->triangles = grow(implicit->triangles, &implicit->triangle_capacity,
+                               2 * triangle_count, sizeof(double));
+
+    implicit->count = implicit->triangle_count = 0;
+    for (long long iy = r.first_y; iy <= r.last_y; iy++) {
+        for (long long ix = r.first_x; ix <= r.last_x; ix++) {
+            const ImplicitTile* tile =
+                current[(iy - range.first_y) * width + (ix - range.first_x)];
+            memcpy(implicit->xs + implicit->count, tile->xs, tile->count * sizeof(double));
+            memcpy(implicit->ys + implicit->count, tile->ys, tile->count * sizeof(double));
+            implicit->count += tile->count;
+            memcpy(implicit->triangles + 2 * implicit->triangle_count, tile->triangles,
+                   2 * tile->triangle_count * sizeof(double));
+            implicit->triangle_count += tile->triangle_count;
+        }
+    }
+}
+
+bool implicit_update(Implicit* implicit, ThreadPool* pool, double min_x, double max_x,
+                     double min_y, double max_y, double pixel_x, double pixel_y)
+{
+    if (!(max_x > min_x) || !(max_y > min_y) || !(pixel_x > 0) || !(pixel_y > 0))
+        return false;
+
+    // Cells of at most a pixel, made coarser when the view would take too many tiles
+    int level_x = (int)floor(log2(pixel_x));
+    int level_y = (int)floor(log2(pixel_y));
+    TileRange view, range;
+    for (;;) {
+        const double width = ldexp(IMPLICIT_TILE, level_x);
+        const double height = ldexp(IMPLICIT_TILE, level_y);
+        view = (TileRange){(long long)floor(min_x / width), (long long)floor(max_x / width),
+                           (long long)floor(min_y / height), (long long)floor(max_y / height)};
+        range = (TileRange){view.first_x - 1, view.last_x + 1, view.first_y - 1,
+                            view.last_y + 1};
+        if (range_size(range) <= IMPLICIT_MAX_TILES)
+            break;
+        level_x++;
+        level_y++;
+    }
+
+    // Nothing to do when the view still maps to the same tiles and they are all stitched
+    const long long key[6] = {level_x, level_y, range.first_x, range.last_x, range.first_y,
+                              range.last_y};
+    if (memcmp(key, implicit->request, sizeof(key)) == 0 && implicit->complete)
+        return false;
+    memcpy(implicit->request, key, sizeof(key));
+    implicit->complete = false;
+    implicit->frame++;
+
+    // The cached tiles of the range, gathered in one pass over the cache
+    ImplicitTile* current[IMPLICIT_MAX_TILES] = {0};
+    const long long width = range.last_x - range.first_x + 1;
+    for (int i = 0; i < IMPLICIT_CACHE; i++) {
+        ImplicitTile* tile = &implicit->tiles[i];
+        if (atomic_load_explicit(&tile->state, memory_order_acquire) == CHUNK_EMPTY ||
+            tile->level_x != level_x || tile->level_y != level_y || tile->ix < range.first_x ||
+            tile->ix > range.last_x || tile->iy < range.first_y || tile->iy > range.last_y)
+            continue;
+        tile->last_used = implicit->frame;
+        current[(tile->iy - range.first_y) * width + (tile->ix - range.first_x)] = tile;
+    }
+
+    // The visible tiles are queued first so the workers get to them first
+    for (long long iy = view.first_y; iy <= view.last_y; iy++) {
+        for (long long ix = view.first_x; ix <= view.last_x; ix++)
+            request(implicit, pool,
+                    &current[(iy - range.first_y) * width + (ix - range.first_x)], level_x,
+                    level_y, ix, iy);
+    }
+    bool complete = true;
+    for (long long iy = range.first_y; iy <= range.last_y; iy++) {
+        for (long long ix = range.first_x; ix <= range.last_x; ix++) {
+            ImplicitTile** slot = &current[(iy - range.first_y) * width + (ix - range.first_x)];
+            request(implicit, pool, slot, level_x, level_y, ix, iy);
+            const bool visible = ix >= view.first_x && ix <= view.last_x &&
+                                 iy >= view.first_y && iy <= view.last_y;
+            if (!is_ready(*slot)) {
+                if (visible)
+                    return false;
+                complete = false;
+            }
+        }
+    }
+    implicit->complete = complete;
+
+    // While the margin fills in, keep what is stitched as long as it covers the view
+    const long long* covered = implicit->covered;
+    if (!complete && level_x == implicit->level_x && level_y == implicit->level_y &&
+        covered[0] <= view.first_x && covered[1] >= view.last_x && covered[2] <= view.first_y &&
+        covered[3] >= view.last_y)
+        return false;
+
+    const TileRange stitched = complete ? range : view;
+    stitch(implicit, current, range, stitched);
+    implicit->level_x = level_x;
+    implicit->level_y = level_y;
+    implicit->covered[0] = stitched.first_x;
+    implicit->covered[1] = stitched.last_x;
+    implicit->covered[2] = stitched.first_y;
+    implicit->covered[3] = stitched.last_y;
+    return true;
+}
@@ -0,0 +1,247 @@
+#include "interval.h"
+
+#include <math.h>
+
+#define PI 3.14159265358979323846
+#define TAU 6.28318530717958647692
+
+static const Interval EMPTY = {INFINITY, -INFINITY};
+static const Interval ENTIRE = {-INFINITY, INFINITY};
+
+bool interval_empty(Interval a)
+{
+    return !(a.lo <= a.hi);
+}
+
+static Interval increasing(Interval a, double (*f)(double))
+{
+    return interval_empty(a) ? EMPTY : (Interval){f(a.lo), f(a.hi)};
+}
+
+static Interval decreasing(Interval a, double (*f)(double))
+{
+    return interval_empty(a) ? EMPTY : (Interval){f(a.hi), f(a.lo)};
+}
+
+// For functions that fall to a minimum of f(0) at 0 and rise on both sides
+static Interval even(Interval a, double (*f)(double))
+{
+    if (a.lo >= 0)
+        return increasing(a, f);
+    if (a.hi <= 0)
+        return decreasing(a, f);
+    return (Interval){f(0), fmax(f(a.lo), f(a.hi))};
+}
+
+// Restricts `a` to the domain [lo, hi] of a function
+static Interval clip(Interval a, double lo, double hi)
+{
+    return (Interval){fmax(a.lo, lo), fmin(a.hi, hi)};
+}
+
+static double square(double a)
+{
+    return a * a;
+}
+
+// 0 * inf is taken to be 0, the limit of the products inside the intervals
+static double product(double a, double b)
+{
+    return a == 0 || b == 0 ? 0 : a * b;
+}
+
+static Interval mul(Interval a, Interval b)
+{
+    const double p[4] = {product(a.lo, b.lo), product(a.lo, b.hi), product(a.hi, b.lo),
+                         product(a.hi, b.hi)};
+    return (Interval){fmin(fmin(p[0], p[1]), fmin(p[2], p[3])),
+                      fmax(fmax(p[0], p[1]), fmax(p[2], p[3]))};
+}
+
+static Interval reciprocal(Interval a)
+{
+    if (a.lo == 0 && a.hi == 0)
+        return EMPTY;
+    if (a.lo < 0 && a.hi > 0)
+        return ENTIRE;
+    if (a.lo == 0)
+        return (Interval){1 / a.hi, INFINITY};
+    if (a.hi == 0)
+        return (Interval){-INFINITY, 1 / a.lo};
+    return (Interval){1 / a.hi, 1 / a.lo};
+}
+
+static Interval pow_const(Interval a, double k)
+{
+    if (k == floor(k) && fabs(k) < 1 << 30) {
+        const long n = (long)k;
+        if (n == 0)
+            return (Interval){1, 1};
+        if (n < 0)
+            return reciprocal(pow_const(a, -k));
+
+        const double lo = pow(a.lo, k), hi = pow(a.hi, k);
+        if (n % 2 == 1 || a.lo >= 0)
+            return (Interval){fmin(lo, hi), fmax(lo, hi)};
+        if (a.hi <= 0)
+            return (Interval){hi, lo};
+        return (Interval){0, fmax(lo, hi)};
+    }
+
+    // Fractional powers are only defined for x >= 0
+    a = clip(a, 0, INFINITY);
+    if (interval_empty(a))
+        return EMPTY;
+    return k > 0 ? (Interval){pow(a.lo, k), pow(a.hi, k)}
+                 : (Interval){pow(a.hi, k), pow(a.lo, k)};
+}
+
+static Interval pow_interval(Interval a, Interval b)
+{
+    if (b.lo == b.hi)
+        return pow_const(a, b.lo);
+    if (a.lo < 0)
+        return ENTIRE;
+
+    // a^b = e^(b ln a) for a >= 0
+    const Interval ln = increasing(a, log);
+    const Interval e = mul(b, ln);
+    return increasing(e, exp);
+}
+
+static Interval const_pow(double k, Interval a)
+{
+    if (k == 1)
+        return (Interval){1, 1};
+    if (k > 1)
+        return (Interval){pow(k, a.lo), pow(k, a.hi)};
+    if (k > 0)
+        return (Interval){pow(k, a.hi), pow(k, a.lo)};
+    return ENTIRE;
+}
+
+// Whether `a` holds phase + period * k for some integer k
+static bool holds_phase(Interval a, double phase, double period)
+{
+    return ceil((a.lo - phase) / period) <= floor((a.hi - phase) / period);
+}
+
+// Sine and cosine over `a`, given where the function peaks and bottoms out
+static Interval periodic(Interval a, double (*f)(double), double peak, double trough)
+{
+    if (!(a.hi - a.lo < TAU))
+        return (Interval){-1, 1};
+
+    const double lo = f(a.lo), hi = f(a.hi);
+    Interval r = {fmin(lo, hi), fmax(lo, hi)};
+    if (holds_phase(a, peak, TAU))
+        r.hi = 1;
+    if (holds_phase(a, trough, TAU))
+        r.lo = -1;
+    return r;
+}
+
+static Interval tangent(Interval a)
+{
+    if (!(a.hi - a.lo < PI) || holds_phase(a, PI / 2, PI))
+        return ENTIRE;
+    return increasing(a, tan);
+}
+
+static Interval unary(ExprOp op, Interval a)
+{
+    switch (op) {
+    case OP_NEG: return (Interval){-a.hi, -a.lo};
+    case OP_SQR: return even(a, square);
+    case OP_SIN: return periodic(a, sin, PI / 2, -PI / 2);
+    case OP_COS: return periodic(a, cos, 0, PI);
+    case OP_TAN: return tangent(a);
+    case OP_ASIN: return increasing(clip(a, -1, 1), asin);
+    case OP_ACOS: return decreasing(clip(a, -1, 1), acos);
+    case OP_ATAN: return increasing(a, atan);
+    case OP_SINH: return increasing(a, sinh);
+    case OP_COSH: return even(a, cosh);
+    case OP_TANH: return increasing(a, tanh);
+    case OP_EXP: return increasing(a, exp);
+    case OP_LN: return increasing(clip(a, 0, INFINITY), log);
+    case OP_LOG: return increasing(clip(a, 0, INFINITY), log10);
+    case OP_SQRT: return increasing(clip(a, 0, INFINITY), sqrt);
+    case OP_ABS: return even(a, fabs);
+    case OP_FLOOR: return increasing(a, floor);
+    case OP_CEIL: return increasing(a, ceil);
+    default: return ENTIRE;
+    }
+}
+
+Interval interval_eval(const Expr* e, Interval x, Interval y)
+{
+    Interval regs[EXPR_MAX_REGS] = {0};
+    for (int pc = 0; pc < e->code_len; pc++) {
+        const ExprInstr in = e->code[pc];
+        const Interval a = regs[in.a];
+        const double k = e->consts[in.b];
+        Interval r;
+
+        switch ((ExprOp)in.op) {
+        case OP_X: r = x; break;
+        case OP_Y: r = y; break;
+        case OP_CONST: r = (Interval){k, k}; break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_POW: {
+            const Interval b = regs[in.b];
+            if (interval_empty(a) || interval_empty(b)) {
+                r = EMPTY;
+                break;
+            }
+            if (in.op == OP_ADD)
+                r = (Interval){a.lo + b.lo, a.hi + b.hi};
+            else if (in.op == OP_SUB)
+                r = (Interval){a.lo - b.hi, a.hi - b.lo};
+            else if (in.op == OP_MUL)
+                r = mul(a, b);
+            else if (in.op == OP_DIV)
+                r = interval_empty(reciprocal(b)) ? EMPTY : mul(a, reciprocal(b));
+            else
+                r = pow_interval(a, b);
+            break;
+        }
+        default:
+            if (interval_empty(a)) {
+                r = EMPTY;
+                break;
+            }
+            switch ((ExprOp)in.op) {
+            case OP_ADDK: r = (Interval){a.lo + k, a.hi + k}; break;
+            case OP_SUBK: r = (Interval){a.lo - k, a.hi - k}; break;
+            case OP_KSUB: r = (Interval){k - a.hi, k - a.lo}; break;
+            case OP_MULK: r = mul(a, (Interval){k, k}); break;
+            case OP_DIVK:
+                if (k == 0)
+                    r = EMPTY;
+                else
+                    r = k > 0 ? (Interval){a.lo / k, a.hi / k} : (Interval){a.hi / k, a.lo / k};
+                break;
+            case OP_KDIV: {
+                const Interval inverse = reciprocal(a);
+                r = interval_empty(inverse) ? EMPTY : mul((Interval){k, k}, inverse);
+                break;
+            }
+            case OP_POWK: r = pow_const(a, k); break;
+            case OP_KPOW: r = const_pow(k, a); break;
+            default: r = unary((ExprOp)in.op, a); break;
+            }
+            break;
+        }
+
+        // inf - inf and the like; the true bounds are unknown, not undefined
+        if (isnan(r.lo))
+            r.lo = -INFINITY;
+        if (isnan(r.hi))
+            r.hi = INFINITY;
+        regs[in.dst] = r;
+    }
+    return regs[e->result];
+}
@@ -0,0 +1,83 @@
+#include "label_cache.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static uint32_t hash_text(const char* text)
+{
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (; *text; text++) {
+        hash ^= (unsigned char)*text;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Same layout as DrawTextEx() with a spacing of 0 at the font's base size
+static void layout_label(const Font font, CachedLabel* label)
+{
+    const float padding = (float)font.glyphPadding;
+    float offset_x = 0;
+
+    label->size = MeasureTextEx(font, label->text, font.baseSize, 0);
+    label->glyph_count = 0;
+    for (const char* c = label->text; *c; c++) {
+        const int index = GetGlyphIndex(font, *c);
+        const Rectangle rec = font.recs[index];
+        const GlyphInfo glyph = font.glyphs[index];
+
+        if (*c != ' ' && *c != '\t') {
+            label->glyphs[label->glyph_count++] = (GlyphQuad){
+                .source = {rec.x - padding, rec.y - padding, rec.width + 2 * padding,
+                           rec.height + 2 * padding},
+                .dest = {offset_x + glyph.offsetX - padding, glyph.offsetY - padding,
+                         rec.width + 2 * padding, rec.height + 2 * padding},
+            };
+        }
+        offset_x += glyph.advanceX == 0 ? rec.width : (float)glyph.advanceX;
+    }
+}
+
+void label_cache_init(LabelCache* cache, Font font)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->font = font;
+}
+
+const CachedLabel* label_cache_get(LabelCache* cache, const char* text)
+{
+    if (strlen(text) >= LABEL_MAX_CHARS)
+        text = "?";
+
+    uint32_t slot = hash_text(text) % LABEL_CACHE_SIZE;
+    for (int probe = 0; probe < LABEL_CACHE_SIZE; probe++) {
+        CachedLabel* label = &cache->labels[slot];
+        if (!label->used)
+            break;
+        if (strcmp(label->text, text) == 0)
+            return label;
+        slot = (slot + 1) % LABEL_CACHE_SIZE;
+    }
+
+    // The table only fills up after zooming through many distinct ranges; start over then
+    if (cache->labels[slot].used) {
+        label_cache_init(cache, cache->font);
+        slot = hash_text(text) % LABEL_CACHE_SIZE;
+    }
+
+    CachedLabel* label = &cache->labels[slot];
+    label->used = true;
+    strcpy(label->text, text);
+    layout_label(cache->font, label);
+    return label;
+}
+
+void label_draw(const LabelCache* cache, const CachedLabel* label, Vector2 position, Color tint)
+{
+    for (int i = 0; i < label->glyph_count; i++) {
+        const GlyphQuad* quad = &label->glyphs[i];
+        const Rectangle dest = {position.x + quad->dest.x, position.y + quad->dest.y,
+                                quad->dest.width, quad->dest.height};
+        DrawTexturePro(cache->font.texture, quad->source, dest, (Vector2){0, 0}, 0, tint);
+    }
+}
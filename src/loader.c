@@ -0,0 +1,410 @@
+// mmap flags such as MAP_ANONYMOUS and madvise() are not part of strict C17
+#define _DEFAULT_SOURCE
+
+#include "loader.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Platform layer: read-only file mappings and address space that is committed on demand
+
+static bool map_file(const char* path, const unsigned char** data, size_t* size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        return false;
+
+    *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    *size = (size_t)file_size.QuadPart;
+    return *data != NULL;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+
+    madvise(mapped, (size_t)st.st_size, MADV_SEQUENTIAL);
+    *data = mapped;
+    *size = (size_t)st.st_size;
+    return true;
+#endif
+}
+
+static void unmap_file(const unsigned char* data, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void*)data, size);
+#endif
+}
+
+// Lets the kernel drop file pages that were already parsed so they do not add to the RSS
+static void release_parsed(const unsigned char* data, size_t from, size_t to)
+{
+#ifdef _WIN32
+    (void)data, (void)from, (void)to;
+#else
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    from = (from + page - 1) / page * page;
+    to = to / page * page;
+    if (to > from)
+        madvise((void*)(data + from), to - from, MADV_DONTNEED);
+#endif
+}
+
+static void* reserve(size_t bytes)
+{
+#ifdef _WIN32
+    return VirtualAlloc(NULL, bytes, MEM_RESERVE, PAGE_READWRITE);
+#else
+    void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                   -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+#endif
+}
+
+static void commit(void* p, size_t bytes)
+{
+#ifdef _WIN32
+    VirtualAlloc(p, bytes, MEM_COMMIT, PAGE_READWRITE);
+#else
+    // Anonymous pages are committed when first touched
+    (void)p, (void)bytes;
+#endif
+}
+
+static void release(void* p, size_t bytes)
+{
+    if (p == NULL)
+        return;
+#ifdef _WIN32
+    (void)bytes;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, bytes);
+#endif
+}
+
+size_t peak_rss_bytes(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// Number parsing. Most values in a CSV have few enough digits to be converted exactly with one
+// multiplication or division by a power of ten; anything else goes through strtod().
+
+static const double POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                               1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                               1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static bool is_separator(char c)
+{
+    return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool parse_slow(const char** cursor, const char* end, double* out)
+{
+    char buffer[64];
+    size_t len = 0;
+    while (*cursor + len < end && len < sizeof(buffer) - 1 && !is_separator((*cursor)[len]))
+        len++;
+    memcpy(buffer, *cursor, len);
+    buffer[len] = '\0';
+
+    char* parsed_end;
+    *out = strtod(buffer, &parsed_end);
+    if (parsed_end == buffer)
+        return false;
+    *cursor += parsed_end - buffer;
+    return true;
+}
+
+static bool parse_number(const char** cursor, const char* end, double* out)
+{
+    const char* p = *cursor;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false, truncated = false;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+            truncated = true;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            } else {
+                truncated = true;
+            }
+        }
+    }
+    if (!any)
+        return parse_slow(cursor, end, out); // "nan", "inf", ...
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* e = p + 1;
+        bool exp_negative = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            exp_negative = *e == '-';
+            e++;
+        }
+        if (e < end && *e >= '0' && *e <= '9') {
+            int value = 0;
+            for (; e < end && *e >= '0' && *e <= '9'; e++) {
+                if (value < 10000)
+                    value = value * 10 + (*e - '0');
+            }
+            exponent += exp_negative ? -value : value;
+            p = e;
+        }
+    }
+
+    if (truncated || mantissa > (UINT64_C(1) << 53) || exponent < -22 || exponent > 22)
+        return parse_slow(cursor, end, out);
+
+    double value = (double)mantissa;
+    value = exponent < 0 ? value / POW10[-exponent] : value * POW10[exponent];
+    *out = negative ? -value : value;
+    *cursor = p;
+    return true;
+}
+
+static const char* skip_blanks(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+int parse_values(const char* line, const char* end, double* values, int max)
+{
+    const char* p = skip_blanks(line, end);
+    int count = 0;
+    while (count < max && parse_number(&p, end, &values[count])) {
+        count++;
+        p = skip_blanks(p, end);
+        if (p < end && (*p == ',' || *p == ';'))
+            p++;
+        p = skip_blanks(p, end);
+    }
+    return count;
+}
+
+// Background thread
+
+// A reader that sees `count` also sees whether the samples up to it are sorted
+static void publish(Loader* loader, size_t count, bool sorted)
+{
+    if (!sorted)
+        atomic_store_explicit(&loader->sorted, false, memory_order_relaxed);
+    atomic_store_explicit(&loader->published, count, memory_order_release);
+}
+
+static void load_csv(Loader* loader, bool* sorted)
+{
+    const char* const begin = (const char*)loader->data;
+    const char* const end = begin + loader->size;
+    const char* line = begin;
+    size_t count = 0, committed = 0, released = 0;
+    double last_x = -INFINITY;
+
+    while (line < end && !atomic_load_explicit(&loader->cancel, memory_order_relaxed)) {
+        const char* line_end = memchr(line, '\n', (size_t)(end - line));
+        if (line_end == NULL)
+            line_end = end;
+
+        double values[2];
+        const int found = parse_values(line, line_end, values, 2);
+        line = line_end + 1;
+
+        // Lines that do not start with two numbers (headers, comments) are skipped
+        if (found < 2)
+            continue;
+        const double x = values[0], y = values[1];
+
+        if (count == committed) {
+            size_t n = count + LOADER_BATCH < loader->reserved ? LOADER_BATCH
+                                                               : loader->reserved - count;
+            commit(loader->xs + count, n * sizeof(double));
+            commit(loader->ys + count, n * sizeof(double));
+            committed += n;
+        }
+        if (x < last_x)
+            *sorted = false;
+        last_x = x;
+        loader->xs[count] = x;
+        loader->ys[count] = y;
+        count++;
+
+        if (count % LOADER_BATCH == 0) {
+            publish(loader, count, *sorted);
+            const size_t parsed = (size_t)(line - begin);
+            release_parsed(loader->data, released, parsed);
+            released = parsed;
+        }
+    }
+    publish(loader, count, *sorted);
+}
+
+static void load_f64(Loader* loader, bool* sorted)
+{
+    const size_t total = loader->size / (2 * sizeof(double));
+    double last_x = -INFINITY;
+
+    for (size_t start = 0; start < total; start += LOADER_BATCH) {
+        if (atomic_load_explicit(&loader->cancel, memory_order_relaxed))
+            break;
+
+        const size_t n = total - start < LOADER_BATCH ? total - start : LOADER_BATCH;
+        commit(loader->xs + start, n * sizeof(double));
+        commit(loader->ys + start, n * sizeof(double));
+
+        // Split the interleaved pairs into the two columns
+        const unsigned char* src = loader->data + start * 2 * sizeof(double);
+        for (size_t i = 0; i < n; i++) {
+            memcpy(&loader->xs[start + i], src + 16 * i, sizeof(double));
+            memcpy(&loader->ys[start + i], src + 16 * i + 8, sizeof(double));
+            if (loader->xs[start + i] < last_x)
+                *sorted = false;
+            last_x = loader->xs[start + i];
+        }
+
+        publish(loader, start + n, *sorted);
+        release_parsed(loader->data, start * 16, (start + n) * 16);
+    }
+}
+
+static void* load_thread(void* arg)
+{
+    Loader* loader = arg;
+    const double start = now();
+    bool sorted = true;
+
+    if (loader->format == LOADER_CSV)
+        load_csv(loader, &sorted);
+    else
+        load_f64(loader, &sorted);
+
+    loader->seconds = now() - start;
+    atomic_store_explicit(&loader->done, true, memory_order_release);
+    return NULL;
+}
+
+bool loader_start(Loader* loader, const char* path, LoaderFormat format)
+{
+    memset(loader, 0, sizeof(*loader));
+    loader->format = format;
+
+    if (!map_file(path, &loader->data, &loader->size)) {
+        fprintf(stderr, "%s: cannot open or map the file\n", path);
+        return false;
+    }
+
+    // The shortest CSV line is "0,0\n", which bounds the number of samples in the file
+    loader->reserved = format == LOADER_CSV ? loader->size / 4 + 1
+                                            : loader->size / (2 * sizeof(double));
+    loader->xs = reserve(loader->reserved * sizeof(double));
+    loader->ys = reserve(loader->reserved * sizeof(double));
+    if (loader->xs == NULL || loader->ys == NULL) {
+        fprintf(stderr, "%s: cannot reserve memory for %zu samples\n", path, loader->reserved);
+        loader_close(loader);
+        return false;
+    }
+
+    atomic_init(&loader->sorted, true);
+    if (pthread_create(&loader->thread, NULL, load_thread, loader) != 0) {
+        fprintf(stderr, "%s: cannot start the loader thread\n", path);
+        loader_close(loader);
+        return false;
+    }
+    loader->started = true;
+    return true;
+}
+
+void loader_close(Loader* loader)
+{
+    if (loader->started) {
+        atomic_store(&loader->cancel, true);
+        pthread_join(loader->thread, NULL);
+    }
+    if (loader->data != NULL)
+        unmap_file(loader->data, loader->size);
+
+    release(loader->xs, loader->reserved * sizeof(double));
+    release(loader->ys, loader->reserved * sizeof(double));
+    memset(loader, 0, sizeof(*loader));
+}
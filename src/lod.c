@@ -0,0 +1,324 @@
+#include "lod.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_INDEX ((size_t)-1)
+
+static void keep_min(const double* ys, size_t i, size_t* best)
+{
+    if (i != NO_INDEX && (*best == NO_INDEX || ys[i] < ys[*best]))
+        *best = i;
+}
+
+static void keep_max(const double* ys, size_t i, size_t* best)
+{
+    if (i != NO_INDEX && (*best == NO_INDEX || ys[i] > ys[*best]))
+        *best = i;
+}
+
+void lod_build(LodPyramid* lod, const double* ys, size_t count)
+{
+    // Keep the allocations, only forget the contents
+    for (int l = 0; l < lod->levels; l++) {
+        lod->blocks[l] = 0;
+    }
+    lod->count = 0;
+    lod_extend(lod, ys, count);
+}
+
+void lod_extend(LodPyramid* lod, const double* ys, size_t count)
+{
+    lod->count = count;
+
+    size_t blocks = count / LOD_BLOCK;
+    for (int l = 0; l < LOD_MAX_LEVELS && blocks > 0; l++, blocks /= 2) {
+        if (blocks > lod->capacity[l]) {
+            size_t capacity = lod->capacity[l] * 2 > blocks ? lod->capacity[l] * 2 : blocks;
+            lod->min_index[l] = realloc(lod->min_index[l], capacity * sizeof(size_t));
+            lod->max_index[l] = realloc(lod->max_index[l], capacity * sizeof(size_t));
+            lod->gap_index[l] = realloc(lod->gap_index[l], capacity * sizeof(size_t));
+            lod->capacity[l] = capacity;
+        }
+
+        for (size_t b = lod->blocks[l]; b < blocks; b++) {
+            size_t imin = NO_INDEX, imax = NO_INDEX, igap = NO_INDEX;
+            if (l == 0) {
+                for (size_t i = b * LOD_BLOCK; i < (b + 1) * LOD_BLOCK; i++) {
+                    if (!isfinite(ys[i])) {
+                        if (igap == NO_INDEX)
+                            igap = i;
+                        continue;
+                    }
+                    keep_min(ys, i, &imin);
+                    keep_max(ys, i, &imax);
+                }
+            } else {
+                for (size_t child = 2 * b; child < 2 * b + 2; child++) {
+                    keep_min(ys, lod->min_index[l - 1][child], &imin);
+                    keep_max(ys, lod->max_index[l - 1][child], &imax);
+                    if (igap == NO_INDEX)
+                        igap = lod->gap_index[l - 1][child];
+                }
+            }
+            lod->min_index[l][b] = imin;
+            lod->max_index[l][b] = imax;
+            lod->gap_index[l][b] = igap;
+        }
+
+        lod->blocks[l] = blocks;
+        if (l + 1 > lod->levels)
+            lod->levels = l + 1;
+    }
+}
+
+void lod_free(LodPyramid* lod)
+{
+    for (int l = 0; l < lod->levels; l++) {
+        free(lod->min_index[l]);
+        free(lod->max_index[l]);
+        free(lod->gap_index[l]);
+    }
+    memset(lod, 0, sizeof(*lod));
+}
+
+void lod_range_minmax(const LodPyramid* lod, const double* ys, size_t begin, size_t end,
+                      size_t* min_index, size_t* max_index)
+{
+    size_t imin = NO_INDEX, imax = NO_INDEX;
+
+    // Scan the unaligned head and tail directly, then climb the pyramid over the full blocks
+    // in between like a bottom-up segment tree.
+    while (begin < end && (begin % LOD_BLOCK != 0 || end - begin < LOD_BLOCK)) {
+        if (isfinite(ys[begin])) {
+            keep_min(ys, begin, &imin);
+            keep_max(ys, begin, &imax);
+        }
+        begin++;
+    }
+    while (end > begin && end % LOD_BLOCK != 0) {
+        end--;
+        if (isfinite(ys[end])) {
+            keep_min(ys, end, &imin);
+            keep_max(ys, end, &imax);
+        }
+    }
+
+    size_t lo = begin / LOD_BLOCK, hi = end / LOD_BLOCK;
+    for (int l = 0; lo < hi && l < lod->levels; l++, lo /= 2, hi /= 2) {
+        if (lo & 1) {
+            keep_min(ys, lod->min_index[l][lo], &imin);
+            keep_max(ys, lod->max_index[l][lo], &imax);
+            lo++;
+        }
+        if (hi & 1) {
+            hi--;
+            keep_min(ys, lod->min_index[l][hi], &imin);
+            keep_max(ys, lod->max_index[l][hi], &imax);
+        }
+    }
+
+    *min_index = imin;
+    *max_index = imax;
+}
+
+// Whether every finite y of block `b` at level `l` lies in [lo, hi]
+static bool block_inside(const LodPyramid* lod, const double* ys, int l, size_t b, double lo,
+                         double hi)
+{
+    const size_t imin = lod->min_index[l][b], imax = lod->max_index[l][b];
+    return imin == NO_INDEX || (ys[imin] >= lo && ys[imax] <= hi);
+}
+
+size_t lod_find_outside(const LodPyramid* lod, const double* ys, size_t begin, size_t end,
+                        double lo, double hi)
+{
+    size_t i = begin;
+    while (i < end) {
+        if (i % LOD_BLOCK != 0 || end - i < LOD_BLOCK) {
+            if (ys[i] < lo || ys[i] > hi)
+                return i;
+            i++;
+            continue;
+        }
+
+        // Climb to the largest block that starts at i and ends by `end`, then go down its left
+        // edge until a block holds a value outside or the block can be skipped
+        int l = 0;
+        size_t b = i / LOD_BLOCK;
+        while (l + 1 < lod->levels && b % 2 == 0 && b / 2 < lod->blocks[l + 1] &&
+               i + ((size_t)LOD_BLOCK << (l + 1)) <= end) {
+            l++;
+            b /= 2;
+        }
+        while (l > 0 && !block_inside(lod, ys, l, b, lo, hi)) {
+            l--;
+            b *= 2;
+        }
+        if (block_inside(lod, ys, l, b, lo, hi)) {
+            i += (size_t)LOD_BLOCK << l;
+            continue;
+        }
+        for (const size_t block_end = i + LOD_BLOCK; i < block_end; i++) {
+            if (ys[i] < lo || ys[i] > hi)
+                return i;
+        }
+    }
+    return NO_INDEX;
+}
+
+size_t lod_find_gap(const LodPyramid* lod, const double* ys, size_t begin, size_t end)
+{
+    size_t i = begin;
+    while (i < end) {
+        if (i % LOD_BLOCK != 0 || end - i < LOD_BLOCK) {
+            if (!isfinite(ys[i]))
+                return i;
+            i++;
+            continue;
+        }
+
+        // The largest block that starts at i and ends by `end` either holds the answer as its
+        // first gap or can be skipped
+        int l = 0;
+        size_t b = i / LOD_BLOCK;
+        while (l + 1 < lod->levels && b % 2 == 0 && b / 2 < lod->blocks[l + 1] &&
+               i + ((size_t)LOD_BLOCK << (l + 1)) <= end) {
+            l++;
+            b /= 2;
+        }
+        if (lod->gap_index[l][b] != NO_INDEX)
+            return lod->gap_index[l][b];
+        i += (size_t)LOD_BLOCK << l;
+    }
+    return NO_INDEX;
+}
+
+// First index in [lo, hi) whose x is >= value (or > value when `inclusive` is false)
+static size_t search(const double* xs, size_t lo, size_t hi, double value, bool inclusive)
+{
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (inclusive ? xs[mid] < value : xs[mid] <= value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Appends the points that draw [a, b) within one column: the first and last points bracket the
+// min, the max and the first gap, in index order
+static size_t keep_run(const LodPyramid* lod, const double* ys, size_t a, size_t b, size_t gap,
+                       size_t* out, size_t len)
+{
+    size_t picks[5] = {a, NO_INDEX, NO_INDEX, gap, b - 1};
+    lod_range_minmax(lod, ys, a, b, &picks[1], &picks[2]);
+    for (int i = 2; i < 4; i++) {
+        for (int j = i; j > 1 && picks[j] < picks[j - 1]; j--) {
+            size_t tmp = picks[j];
+            picks[j] = picks[j - 1];
+            picks[j - 1] = tmp;
+        }
+    }
+
+    for (int i = 0; i < 5; i++) {
+        if (picks[i] != NO_INDEX && (len == 0 || picks[i] > out[len - 1]))
+            out[len++] = picks[i];
+    }
+    return len;
+}
+
+size_t lod_decimate(const LodPyramid* lod, const double* xs, const double* ys, double min_x,
+                    double max_x, int columns, size_t* out)
+{
+    const size_t n = lod->count;
+    if (n == 0 || columns <= 0)
+        return 0;
+
+    const size_t first = search(xs, 0, n, min_x, true);
+    const size_t last = search(xs, first, n, max_x, false);
+    const size_t begin = first > 0 ? first - 1 : 0;
+    const size_t end = last < n ? last + 1 : n;
+
+    size_t len = 0;
+    if (end - begin <= 5 * (size_t)columns + 2) {
+        for (size_t i = begin; i < end; i++)
+            out[len++] = i;
+        return len;
+    }
+
+    if (begin < first)
+        out[len++] = begin;
+
+    const double column_width = (max_x - min_x) / columns;
+    size_t a = first;
+    for (int c = 0; c < columns && a < last; c++) {
+        size_t b = c == columns - 1 ? last
+                                    : search(xs, a, last, min_x + (c + 1) * column_width, true);
+        if (a == b)
+            continue;
+
+        len = keep_run(lod, ys, a, b, lod_find_gap(lod, ys, a, b), out, len);
+        a = b;
+    }
+
+    if (end > last)
+        out[len++] = end - 1;
+    return len;
+}
+
+size_t lod_decimate_unsorted(const LodPyramid* x_lod, const LodPyramid* lod, const double* xs,
+                             const double* ys, double min_x, double max_x, int columns,
+                             size_t* out, size_t max)
+{
+    const size_t n = lod->count;
+    if (n == 0 || columns <= 0)
+        return 0;
+
+    const double column_width = (max_x - min_x) / columns;
+    size_t len = 0;
+    for (size_t a = 0; a < n;) {
+        if (len + 5 > max)
+            return NO_INDEX;
+        const double x = xs[a];
+        if (!isfinite(x)) {
+            out[len++] = a++;
+            continue;
+        }
+
+        // The run of points from `a` that stay on the same side of the view or in one column
+        double lo, hi;
+        const bool outside = x < min_x || x > max_x;
+        if (x < min_x) {
+            lo = -INFINITY;
+            hi = nextafter(min_x, -INFINITY);
+        } else if (x > max_x) {
+            lo = nextafter(max_x, INFINITY);
+            hi = INFINITY;
+        } else {
+            int c = (int)((x - min_x) / column_width);
+            c = c > columns - 1 ? columns - 1 : c;
+            lo = fmin(x, min_x + c * column_width);
+            hi = c == columns - 1 ? max_x : nextafter(min_x + (c + 1) * column_width, -INFINITY);
+            hi = fmax(x, hi);
+        }
+        size_t b = lod_find_outside(x_lod, xs, a + 1, n, lo, hi);
+        if (b == NO_INDEX)
+            b = n;
+
+        // A line between two points on the same side of the view never crosses it
+        if (outside) {
+            out[len++] = a;
+            if (b - 1 > a)
+                out[len++] = b - 1;
+        } else {
+            const size_t gap_y = lod_find_gap(lod, ys, a, b), gap_x = lod_find_gap(x_lod, xs, a, b);
+            len = keep_run(lod, ys, a, b, gap_y < gap_x ? gap_y : gap_x, out, len);
+        }
+        a = b;
+    }
+    return len;
+}
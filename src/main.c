@@ -1,250 +1,262 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "plot.h"
 #include "raylib.h"
 #include "raymath.h"
 
-Font font;
-
-const Color BACKGROUND = {25, 25, 25, 255};
-
-const float TICK_THICKNESS = 1.0f;
-const Color TICK_COLOR = {128, 128, 128, 125};
-const float MIN_TICKS_PER_QUADRANT = 10;
-const float MAX_TICKS_PER_QUADRANT = 50;
-
-#define ASPECT_RATIO() ((float)GetRenderWidth() / (float)GetRenderHeight())
-
-typedef struct
+int main(int argc, char** argv)
 {
-    Vector2 ticks_per_quadrant;
-    Vector2 total_ticks;
-    int tick_freq;
-
-    double min_x;
-    double max_x;
-    double min_y;
-    double max_y;
-
-    Vector2 origin;
-} CoordPlane;
+    const double start_time = now();
+    const int SCREEN_WIDTH = 800;
+    const int SCREEN_HEIGHT = 600;
 
-void grid_draw(const Rectangle rect, const CoordPlane cp)
-{
-    const Vector2 TICK_OFFSETS = {
-        rect.width / cp.total_ticks.x,
-        rect.height / cp.total_ticks.y,
-    };
-
-    Vector2 tick_start, tick_end, text_pos;
-    float negative_dir, positive_dir, negative_num, positive_num;
-    const char* text;
-    Vector2 text_dim;
-
-    int i;
-    negative_dir = cp.origin.x;
-    negative_num = 0;
-    positive_dir = cp.origin.x;
-    positive_num = 0;
-    for (i = 0; i < cp.ticks_per_quadrant.x; i++) {
-        if (i != 0 && i % cp.tick_freq == 0) {
-            tick_start = (Vector2){negative_dir, rect.y};
-            tick_end = (Vector2){negative_dir, rect.y + rect.height};
-            DrawLineEx(tick_start, tick_end, TICK_THICKNESS, TICK_COLOR);
-
-            text = TextFormat("%d", (int)negative_num);
-            text_dim = MeasureTextEx(font, text, font.baseSize, 0);
-            text_pos = (Vector2){negative_dir - (text_dim.x / 2.0f), cp.origin.y + 5.0f};
-            DrawRectangleV(text_pos, text_dim, BACKGROUND);
-            DrawTextEx(font, text, text_pos, font.baseSize, 0, WHITE);
-
-            tick_start = (Vector2){positive_dir, rect.y};
-            tick_end = (Vector2){positive_dir, rect.y + rect.height};
-            DrawLineEx(tick_start, tick_end, TICK_THICKNESS, TICK_COLOR);
-
-            text = TextFormat("%d", (int)positive_num);
-            text_dim = MeasureTextEx(font, text, font.baseSize, 0);
-            text_pos = (Vector2){positive_dir - (text_dim.x / 2.0f), cp.origin.y + 5.0f};
-            DrawRectangleV(text_pos, text_dim, BACKGROUND);
-            DrawTextEx(font, text, text_pos, font.baseSize, 0, WHITE);
-        }
+    SetConfigFlags(FLAG_MSAA_4X_HINT | FLAG_WINDOW_RESIZABLE);
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Plot GUI");
 
-        negative_dir -= TICK_OFFSETS.x;
-        positive_dir += TICK_OFFSETS.x;
-        if (negative_num > cp.min_x)
-            negative_num--;
-        if (positive_num < cp.max_x)
-            positive_num++;
+    font = LoadFontEx("resources/CM Serif Roman.ttf", 20, NULL, 0);
+    // SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR);
+    SetTextureFilter(font.texture, TEXTURE_FILTER_POINT);
+    label_cache_init(&label_cache, font);
+
+    CoordPlane cp = coord_plane_init();
+
+    // Live series options: the x span that scrolls by (in x units) and the memory cap per series
+    double tail_window = 10;
+    size_t tail_mb = TAIL_DEFAULT_MB;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--window=", 9) == 0)
+            tail_window = atof(argv[i] + 9);
+        else if (strncmp(argv[i], "--max-mb=", 9) == 0)
+            tail_mb = strtoull(argv[i] + 9, NULL, 10);
     }
 
-    negative_dir = cp.origin.y;
-    negative_num = 0;
-    positive_dir = cp.origin.y;
-    positive_num = 0;
-    for (i = 0; i < cp.ticks_per_quadrant.y; i++) {
-        if (i != 0 && i % cp.tick_freq == 0) {
-            tick_start = (Vector2){rect.x, negative_dir};
-            tick_end = (Vector2){rect.x + rect.width, negative_dir};
-            DrawLineEx(tick_start, tick_end, TICK_THICKNESS, TICK_COLOR);
-
-            text = TextFormat("%d", (int)negative_num);
-            text_dim = MeasureTextEx(font, text, font.baseSize, 0);
-            text_pos = (Vector2){cp.origin.x + 5.0f, negative_dir - (text_dim.x / 2.0f)};
-            DrawRectangleV(text_pos, text_dim, BACKGROUND);
-            DrawTextEx(font, text, text_pos, font.baseSize, 0, WHITE);
-
-            tick_start = (Vector2){rect.x, positive_dir};
-            tick_end = (Vector2){rect.x + rect.width, positive_dir};
-            DrawLineEx(tick_start, tick_end, TICK_THICKNESS, TICK_COLOR);
-
-            text = TextFormat("%d", (int)positive_num);
-            text_dim = MeasureTextEx(font, text, font.baseSize, 0);
-            text_pos = (Vector2){cp.origin.x + 5.0f, positive_dir - (text_dim.x / 2.0f)};
-            DrawRectangleV(text_pos, text_dim, BACKGROUND);
-            DrawTextEx(font, text, text_pos, font.baseSize, 0, WHITE);
+    size_t num_of_curves = 0;
+    size_t loading = 0;
+    size_t tailing = 0;
+    Curve* curves = calloc(argc > 1 ? argc - 1 : 1, sizeof(Curve));
+    for (int i = 1; i < argc; i++) {
+        Curve* curve = &curves[num_of_curves];
+        if (strncmp(argv[i], "--", 2) == 0)
+            continue;
+
+        if (is_tail_source(argv[i])) {
+            // Two columns of twice the window of doubles
+            curve->window = tail_mb * (1 << 20) / (4 * sizeof(double));
+            curve->xs = malloc(2 * curve->window * sizeof(double));
+            curve->ys = malloc(2 * curve->window * sizeof(double));
+            curve->tail = malloc(sizeof(Tail));
+            if (curve->window == 0 || curve->xs == NULL || curve->ys == NULL ||
+                !tail_start(curve->tail, argv[i], TAIL_RING_CAPACITY)) {
+                free(curve->xs);
+                free(curve->ys);
+                free(curve->tail);
+                memset(curve, 0, sizeof(*curve));
+                continue;
+            }
+            curve->path = argv[i];
+            curve->color = curve_color(num_of_curves);
+            num_of_curves++;
+            tailing++;
+            continue;
         }
 
-        negative_dir -= TICK_OFFSETS.y;
-        positive_dir += TICK_OFFSETS.y;
-        if (negative_num > cp.min_y)
-            negative_num--;
-        if (positive_num < cp.max_y)
-            positive_num++;
+        LoaderFormat format;
+        if (is_data_file(argv[i], &format)) {
+            curve->loader = malloc(sizeof(Loader));
+            if (!loader_start(curve->loader, argv[i], format)) {
+                free(curve->loader);
+                curve->loader = NULL;
+                continue;
+            }
+            curve->path = argv[i];
+            curve->color = curve_color(num_of_curves);
+            num_of_curves++;
+            loading++;
+            continue;
+        }
+        if (!expr_compile(&curve->expr, argv[i])) {
+            fprintf(stderr, "%s: %s\n", argv[i], curve->expr.error);
+            continue;
+        }
+        curve->color = curve_color(num_of_curves);
+        num_of_curves++;
     }
-
-    DrawLineEx((Vector2){rect.x, cp.origin.y}, (Vector2){rect.x + rect.width, cp.origin.y}, 3.0f,
-               RAYWHITE); // x-axis
-    DrawLineEx((Vector2){cp.origin.x, rect.y}, (Vector2){cp.origin.x, rect.y + rect.height}, 3.0f,
-               RAYWHITE); // y-axis
-}
-
-const float POINT_THICKNESS = 3.0f;
-
-void plot_point(const Rectangle rect, const CoordPlane cp, float x, float y)
-{
-    const Vector2 TICK_OFFSETS = {
-        rect.width / cp.total_ticks.x,
-        rect.height / cp.total_ticks.y,
-    };
-
-    DrawCircleV(Vector2Add(cp.origin, Vector2Multiply(TICK_OFFSETS, (Vector2){x, -y})),
-                POINT_THICKNESS, RED);
-}
-
-void plot_points(const Rectangle rect, const CoordPlane cp, const Vector2* const points,
-                 size_t size)
-{
-#if 1
-    const Vector2 TICK_OFFSETS = {
-        rect.width / cp.total_ticks.x,
-        rect.height / cp.total_ticks.y,
-    };
-    
-    for (size_t i = 1; i < size; i++) {
-        DrawLineEx(
-            Vector2Add(cp.origin, Vector2Multiply(TICK_OFFSETS, (Vector2){points[i-1].x, -points[i-1].y})),
-            Vector2Add(cp.origin, Vector2Multiply(TICK_OFFSETS, (Vector2){points[i].x, -points[i].y})),
-            2.25f,
-            RED
-        );
+    const bool has_data = loading > 0;
+    if (tailing > 0) {
+        cp.unit_x = nice_unit(tail_window / cp.total_ticks.x);
     }
-#else
-    for (size_t i = 0; i < size; i++) {
-        plot_point(rect, cp, points[i].x, points[i].y);
+    if (argc <= 1) {
+        expr_compile(&curves[0].expr, "y = x^2 + 3");
+        curves[0].color = curve_color(0);
+        num_of_curves = 1;
     }
-#endif
-}
 
-void update(CoordPlane* cp)
-{
-    float mouse_wheel = GetMouseWheelMove();
-    const Vector2 ZOOM_DIFF_TO_TICKS_DIFF = {1, 1};
-    if (mouse_wheel < 0.0f) {
-        cp->ticks_per_quadrant = Vector2Add(cp->ticks_per_quadrant, ZOOM_DIFF_TO_TICKS_DIFF);
-    } else if (mouse_wheel > 0.0f) {
-        cp->ticks_per_quadrant = Vector2Subtract(cp->ticks_per_quadrant, ZOOM_DIFF_TO_TICKS_DIFF);
-    }
-    cp->min_x = -cp->ticks_per_quadrant.x;
-    cp->max_x = cp->ticks_per_quadrant.x;
-    cp->min_y = -cp->ticks_per_quadrant.y;
-    cp->max_y = cp->ticks_per_quadrant.y;
-
-    if (cp->ticks_per_quadrant.x > 35.0f) {
-        cp->tick_freq = 4;
-    } else if (cp->ticks_per_quadrant.x > 28.0f) {
-        cp->tick_freq = 3;
-    } else if (cp->ticks_per_quadrant.x > 15.0f) {
-        cp->tick_freq = 2;
-    } else if (cp->ticks_per_quadrant.x < 15.0f) {
-        cp->tick_freq = 1;
+    if (!polyline_renderer_init()) {
+        fprintf(stderr, "Failed to load the curve shader\n");
+        CloseWindow();
+        return 1;
     }
-
-    if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-        cp->origin = Vector2Add(cp->origin, GetMouseDelta());
+    // Expressions are sampled on all but one core, leaving the render thread its own
+    ThreadPool pool;
+    if (!pool_init(&pool, 0)) {
+        fprintf(stderr, "Failed to start the sampling threads\n");
+        polyline_renderer_close();
+        CloseWindow();
+        return 1;
     }
 
-    // Ensure that the ticks per quadrant is between the minimum and maximum amounts
-    cp->ticks_per_quadrant.x = fmin(cp->ticks_per_quadrant.x, MAX_TICKS_PER_QUADRANT);
-    cp->ticks_per_quadrant.x = fmax(MIN_TICKS_PER_QUADRANT, cp->ticks_per_quadrant.x);
-
-    cp->ticks_per_quadrant.y = (float)((int)(1.0f / ASPECT_RATIO() * cp->ticks_per_quadrant.x));
-
-    cp->total_ticks = Vector2Scale(cp->ticks_per_quadrant, 2.0f);
-}
-
-int main(void)
-{
-    const int SCREEN_WIDTH = 800;
-    const int SCREEN_HEIGHT = 600;
-
-    SetConfigFlags(FLAG_MSAA_4X_HINT | FLAG_WINDOW_RESIZABLE);
-    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Plot GUI");
-
-    font = LoadFontEx("resources/CM Serif Roman.ttf", 20, NULL, 0);
-    // SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR);
-    SetTextureFilter(font.texture, TEXTURE_FILTER_POINT);
+    // Only render when the input or the data changed; otherwise block until the next event. While
+    // files are loading, live series are open or curves are being sampled, poll at the frame rate
+    // instead so new samples show up without input.
+    SetTargetFPS(60);
+    bool waiting = false;
+    bool redraw = true;
+    bool view_moved = false;
+    bool following = tailing > 0;
+    bool first_data_frame = true;
+    // I marks where curves cross, E their minima and maxima
+    bool show_crossings = false;
+    bool show_extrema = false;
+    Hover hover = {0, QUERY_NONE};
+
+    Rectangle grid_bounds = {0};
+    GridLayer grid_layer = {0};
+    while (!WindowShouldClose()) {
+        const CoordPlane previous_cp = cp;
+        const PlotInput input = read_input();
+        update(&cp, input);
+        if (!coord_plane_equal(previous_cp, cp))
+            view_moved = true;
+        // Dragging looks back in the history of live series; F follows the newest samples again
+        if (following && input.dragging && Vector2Length(input.drag) > 0)
+            following = false;
+        if (!coord_plane_equal(previous_cp, cp) || IsWindowResized())
+            redraw = true;
+
+        grid_bounds.x = 0;
+        grid_bounds.y = 0;
+        grid_bounds.width = (float)GetRenderWidth() - grid_bounds.x;
+        grid_bounds.height = (float)GetRenderHeight() - grid_bounds.y;
+
+        bool data_arrived = false;
+        bool sampling = false;
+        for (size_t i = 0; i < num_of_curves; i++) {
+            Curve* curve = &curves[i];
+            // Chunks that finish after curve_sample() looked are picked up on the next frame
+            if (curve_pending(curve))
+                sampling = true;
+            if (curve_sample(curve, grid_bounds, cp, &pool))
+                redraw = true;
+            if (curve_pending(curve))
+                sampling = true;
+            if (curve_poll(curve))
+                data_arrived = true;
+            if (curve_drain(curve))
+                data_arrived = true;
+            if (curve->tail != NULL && !curve->ended &&
+                atomic_load_explicit(&curve->tail->ended, memory_order_acquire)) {
+                // The reader pushed everything before it ended, so this empties the ring
+                while (curve_drain(curve))
+                    data_arrived = true;
+                printf("%s: input ended after %zu samples\n", curve->path,
+                       atomic_load(&curve->tail->received));
+                curve->ended = true;
+                tailing--;
+            }
+            if (curve->loader != NULL && !curve->loaded &&
+                atomic_load_explicit(&curve->loader->done, memory_order_acquire)) {
+                curve_poll(curve);
+                printf("%s: %zu samples loaded in %.2f s\n", curve->path, curve->count,
+                       curve->loader->seconds);
+                if (!curve_sorted(curve))
+                    fprintf(stderr, "%s: x values are not sorted; hover and markers are off\n",
+                            curve->path);
+                curve->loaded = true;
+                loading--;
+                data_arrived = true;
+            }
+        }
+        const bool busy = loading > 0 || tailing > 0 || sampling;
+        if (busy == waiting) {
+            waiting = !busy;
+            if (waiting)
+                EnableEventWaiting();
+            else
+                DisableEventWaiting();
+        }
+        if (IsKeyPressed(KEY_F)) {
+            if (tailing > 0)
+                following = true;
+            else if (fit_to_data(&cp, grid_bounds, curves, num_of_curves))
+                redraw = true;
+        }
+        if (IsKeyPressed(KEY_I)) {
+            show_crossings = !show_crossings;
+            redraw = true;
+        }
+        if (IsKeyPressed(KEY_E)) {
+            show_extrema = !show_extrema;
+            redraw = true;
+        }
+        if (data_arrived) {
+            // Follow the data until the user moves the view themselves
+            if (following)
+                follow_tail(&cp, grid_bounds, curves, num_of_curves);
+            else if (!view_moved && tailing == 0)
+                fit_to_data(&cp, grid_bounds, curves, num_of_curves);
+            redraw = true;
+        }
 
-    Vector2 ticks =
-        (Vector2){MIN_TICKS_PER_QUADRANT, (int)(1.0f / ASPECT_RATIO() * MIN_TICKS_PER_QUADRANT)};
-    Vector2 total_ticks = Vector2Scale(ticks, 2);
-    CoordPlane cp = {
-        .ticks_per_quadrant = ticks,
-        .total_ticks = total_ticks,
-        .tick_freq = 1,
-        .min_x = -ticks.x,
-        .max_x = ticks.x,
-        .min_y = -ticks.y,
-        .max_y = ticks.y,
-        .origin = {GetRenderWidth() / 2.0f, GetRenderHeight() / 2.0f},
-    };
-
-    Rectangle grid_bounds;
-    size_t num_of_points = 500;
-    Vector2* points = calloc(num_of_points, sizeof(Vector2));
-
-    float x = -10;
-    for (size_t i = 0; i < num_of_points; i++) {
-        points[i] = (Vector2){x, x * x + 3};
-        x += 20.0f / num_of_points;
-    }
+        // Looked up every frame, since the cursor, the view and the samples all move it
+        const Hover hovered =
+            hover_find(grid_bounds, cp, curves, num_of_curves, GetMousePosition());
+        if (hovered.curve != hover.curve || hovered.index != hover.index)
+            redraw = true;
+        hover = hovered;
+
+        if (!redraw) {
+            if (busy)
+                WaitTime(1.0 / 60.0);
+            PollInputEvents();
+            continue;
+        }
 
-    while (!WindowShouldClose()) {
-        update(&cp);
+        grid_layer_update(&grid_layer, grid_bounds, cp);
 
         BeginDrawing();
         ClearBackground(BACKGROUND);
         {
-            grid_bounds.x = 0;
-            grid_bounds.y = 0;
-            grid_bounds.width = (float)GetRenderWidth() - grid_bounds.x;
-            grid_bounds.height = (float)GetRenderHeight() - grid_bounds.y;
-
-            grid_draw(grid_bounds, cp);
-            plot_points(grid_bounds, cp, points, num_of_points);
+            grid_layer_draw(&grid_layer);
+            for (size_t i = 0; i < num_of_curves; i++) {
+                plot_points(grid_bounds, cp, &curves[i]);
+            }
+            plot_markers(grid_bounds, cp, curves, num_of_curves, show_crossings, show_extrema);
+            hover_draw(grid_bounds, cp, curves, hover);
         }
         EndDrawing();
+        redraw = false;
+
+        if (tailing > 0)
+            tail_stats_present(curves, num_of_curves);
+        if (data_arrived && first_data_frame) {
+            printf("first frame with data after %.1f ms\n", (now() - start_time) * 1e3);
+            first_data_frame = false;
+        }
     }
 
+    grid_layer_unload(&grid_layer);
+    for (size_t i = 0; i < num_of_curves; i++)
+        curve_free(&curves[i]);
+    free(curves);
+    pool_close(&pool);
+    plot_close();
+    polyline_renderer_close();
+
+    if (has_data)
+        printf("peak RSS: %.1f MB\n", peak_rss_bytes() / (double)(1 << 20));
+
     UnloadFont(font);
     CloseWindow();
     return 0;
@@ -0,0 +1,843 @@
+#include "plot.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "raymath.h"
+#include "rlgl.h"
+
+Font font;
+LabelCache label_cache;
+
+const Color BACKGROUND = {25, 25, 25, 255};
+
+static const Color TICK_COLOR = {128, 128, 128, 125};
+const float MIN_TICKS_PER_QUADRANT = 10;
+const float MAX_TICKS_PER_QUADRANT = 50;
+
+CoordPlane coord_plane_init(void)
+{
+    Vector2 ticks = (Vector2){MIN_TICKS_PER_QUADRANT, MIN_TICKS_PER_QUADRANT / ASPECT_RATIO()};
+    Vector2 total_ticks = Vector2Scale(ticks, 2);
+    return (CoordPlane){
+        .ticks_per_quadrant = ticks,
+        .total_ticks = total_ticks,
+        .tick_freq = 1,
+        .stretch_y = 1,
+        .min_x = -ticks.x,
+        .max_x = ticks.x,
+        .min_y = -ticks.y,
+        .max_y = ticks.y,
+        .origin = {GetRenderWidth() / 2.0f, GetRenderHeight() / 2.0f},
+        .unit_x = 1,
+        .unit_y = 1,
+    };
+}
+
+ViewTransform coord_plane_view(const Rectangle rect, const CoordPlane cp)
+{
+    const double scale_x = rect.width / cp.total_ticks.x / cp.unit_x;
+    const double scale_y = -(rect.height / cp.total_ticks.y) / cp.unit_y;
+    return (ViewTransform){
+        scale_x,
+        scale_y,
+        cp.origin.x - scale_x * cp.offset_x,
+        cp.origin.y - scale_y * cp.offset_y,
+    };
+}
+
+typedef struct
+{
+    double value;
+    float position;
+    bool on_x_axis;
+} GridLabel;
+
+static GridLabel* grid_labels = NULL;
+static size_t grid_label_capacity = 0;
+
+static void grid_label_draw(const GridLabel label, const CoordPlane cp)
+{
+    char text[LABEL_MAX_CHARS];
+    snprintf(text, sizeof(text), "%.10g", label.value);
+    const CachedLabel* cached = label_cache_get(&label_cache, text);
+
+    Vector2 text_pos;
+    if (label.on_x_axis) {
+        text_pos = (Vector2){label.position - (cached->size.x / 2.0f), cp.origin.y + 5.0f};
+    } else {
+        text_pos = (Vector2){cp.origin.x + 5.0f, label.position - (cached->size.x / 2.0f)};
+    }
+    DrawRectangleV(text_pos, cached->size, BACKGROUND);
+    label_draw(&label_cache, cached, text_pos, WHITE);
+}
+
+static void grid_draw(const Rectangle rect, const CoordPlane cp)
+{
+    const Vector2 TICK_OFFSETS = {
+        rect.width / cp.total_ticks.x,
+        rect.height / cp.total_ticks.y,
+    };
+
+    // All tick lines go out in one batch; labels are collected and drawn after it. Each axis
+    // gives at most two labels per tick of a quadrant, and narrow windows have many on the y axis.
+    const size_t max_labels =
+        2 * ((size_t)ceilf(cp.ticks_per_quadrant.x) + (size_t)ceilf(cp.ticks_per_quadrant.y));
+    if (max_labels > grid_label_capacity) {
+        grid_label_capacity = max_labels;
+        grid_labels = realloc(grid_labels, grid_label_capacity * sizeof(GridLabel));
+    }
+    GridLabel* labels = grid_labels;
+    int num_of_labels = 0;
+
+    float negative_dir, positive_dir, negative_num, positive_num;
+
+    rlBegin(RL_LINES);
+    rlColor4ub(TICK_COLOR.r, TICK_COLOR.g, TICK_COLOR.b, TICK_COLOR.a);
+
+    int i;
+    negative_dir = cp.origin.x;
+    negative_num = 0;
+    positive_dir = cp.origin.x;
+    positive_num = 0;
+    for (i = 0; i < cp.ticks_per_quadrant.x; i++) {
+        if (i != 0 && i % cp.tick_freq == 0) {
+            rlVertex2f(negative_dir, rect.y);
+            rlVertex2f(negative_dir, rect.y + rect.height);
+            labels[num_of_labels++] =
+                (GridLabel){cp.offset_x + negative_num * cp.unit_x, negative_dir, true};
+
+            rlVertex2f(positive_dir, rect.y);
+            rlVertex2f(positive_dir, rect.y + rect.height);
+            labels[num_of_labels++] =
+                (GridLabel){cp.offset_x + positive_num * cp.unit_x, positive_dir, true};
+        }
+
+        negative_dir -= TICK_OFFSETS.x;
+        positive_dir += TICK_OFFSETS.x;
+        if (negative_num > cp.min_x)
+            negative_num--;
+        if (positive_num < cp.max_x)
+            positive_num++;
+    }
+
+    negative_dir = cp.origin.y;
+    negative_num = 0;
+    positive_dir = cp.origin.y;
+    positive_num = 0;
+    for (i = 0; i < cp.ticks_per_quadrant.y; i++) {
+        if (i != 0 && i % cp.tick_freq == 0) {
+            rlVertex2f(rect.x, negative_dir);
+            rlVertex2f(rect.x + rect.width, negative_dir);
+            labels[num_of_labels++] =
+                (GridLabel){cp.offset_y + negative_num * cp.unit_y, negative_dir, false};
+
+            rlVertex2f(rect.x, positive_dir);
+            rlVertex2f(rect.x + rect.width, positive_dir);
+            labels[num_of_labels++] =
+                (GridLabel){cp.offset_y + positive_num * cp.unit_y, positive_dir, false};
+        }
+
+        negative_dir -= TICK_OFFSETS.y;
+        positive_dir += TICK_OFFSETS.y;
+        if (negative_num > cp.min_y)
+            negative_num--;
+        if (positive_num < cp.max_y)
+            positive_num++;
+    }
+    rlEnd();
+
+    for (i = 0; i < num_of_labels; i++) {
+        grid_label_draw(labels[i], cp);
+    }
+
+    DrawLineEx((Vector2){rect.x, cp.origin.y}, (Vector2){rect.x + rect.width, cp.origin.y}, 3.0f,
+               RAYWHITE); // x-axis
+    DrawLineEx((Vector2){cp.origin.x, rect.y}, (Vector2){cp.origin.x, rect.y + rect.height}, 3.0f,
+               RAYWHITE); // y-axis
+}
+
+bool coord_plane_equal(const CoordPlane a, const CoordPlane b)
+{
+    return a.ticks_per_quadrant.x == b.ticks_per_quadrant.x &&
+           a.ticks_per_quadrant.y == b.ticks_per_quadrant.y &&
+           a.total_ticks.x == b.total_ticks.x && a.total_ticks.y == b.total_ticks.y &&
+           a.tick_freq == b.tick_freq && a.min_x == b.min_x && a.max_x == b.max_x &&
+           a.min_y == b.min_y && a.max_y == b.max_y && a.origin.x == b.origin.x &&
+           a.origin.y == b.origin.y && a.offset_x == b.offset_x && a.offset_y == b.offset_y &&
+           a.unit_x == b.unit_x && a.unit_y == b.unit_y;
+}
+
+void grid_layer_update(GridLayer* layer, const Rectangle rect, const CoordPlane cp)
+{
+    if (layer->valid && coord_plane_equal(layer->cp, cp) && layer->bounds.x == rect.x &&
+        layer->bounds.y == rect.y && layer->bounds.width == rect.width &&
+        layer->bounds.height == rect.height)
+        return;
+
+    if (!layer->valid || layer->target.texture.width != (int)rect.width ||
+        layer->target.texture.height != (int)rect.height) {
+        if (layer->valid)
+            UnloadRenderTexture(layer->target);
+        layer->target = LoadRenderTexture((int)rect.width, (int)rect.height);
+    }
+
+    CoordPlane local = cp;
+    local.origin = Vector2Subtract(cp.origin, (Vector2){rect.x, rect.y});
+
+    // Translucent lines and glyph edges must leave the layer opaque. Blending their alpha like
+    // their color would let the background show through again when the layer is drawn.
+    BeginTextureMode(layer->target);
+    ClearBackground(BACKGROUND);
+    rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA,
+                              RL_FUNC_ADD, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+    grid_draw((Rectangle){0, 0, rect.width, rect.height}, local);
+    EndBlendMode();
+    EndTextureMode();
+
+    layer->bounds = rect;
+    layer->cp = cp;
+    layer->valid = true;
+}
+
+void grid_layer_draw(const GridLayer* layer)
+{
+    // Render textures are stored upside down
+    const Rectangle source = {0, 0, (float)layer->target.texture.width,
+                              -(float)layer->target.texture.height};
+    DrawTextureRec(layer->target.texture, source, (Vector2){layer->bounds.x, layer->bounds.y},
+                   WHITE);
+}
+
+void grid_layer_unload(GridLayer* layer)
+{
+    if (layer->valid)
+        UnloadRenderTexture(layer->target);
+    layer->valid = false;
+}
+
+static const float POINT_THICKNESS = 3.0f;
+
+void plot_point(const Rectangle rect, const CoordPlane cp, double x, double y)
+{
+    const ViewTransform view = coord_plane_view(rect, cp);
+    DrawCircleV((Vector2){view.offset_x + view.scale_x * x, view.offset_y + view.scale_y * y},
+                POINT_THICKNESS, RED);
+}
+
+static const float LINE_THICKNESS = 2.25f;
+static const unsigned char FILL_ALPHA = 60;
+
+// Series longer than this are not kept on the GPU whole. Only the points that survive pixel
+// column decimation are uploaded, and again whenever the view changes.
+static const size_t MAX_GPU_POINTS = 1 << 20;
+
+static const Color CURVE_COLORS[] = {
+    {230, 41, 55, 255}, {102, 191, 255, 255}, {0, 228, 48, 255},
+    {255, 161, 0, 255}, {200, 122, 255, 255}, {255, 203, 0, 255},
+};
+
+static size_t* lod_indices = NULL;
+static size_t lod_capacity = 0;
+
+Color curve_color(size_t index)
+{
+    return CURVE_COLORS[index % (sizeof(CURVE_COLORS) / sizeof(Color))];
+}
+
+// Shades the inside of an inequality. The triangles are mapped to the screen on the CPU so that
+// far-off coordinates keep their precision.
+static void plot_fill(const ViewTransform view, const Implicit* implicit, Color color)
+{
+    if (implicit->triangle_count == 0)
+        return;
+
+    // Triangles flip their winding with the y axis
+    rlDrawRenderBatchActive();
+    rlDisableBackfaceCulling();
+    rlBegin(RL_TRIANGLES);
+    rlColor4ub(color.r, color.g, color.b, FILL_ALPHA);
+    for (size_t i = 0; i < implicit->triangle_count; i++) {
+        const double* p = &implicit->triangles[2 * i];
+        rlVertex2f((float)(view.offset_x + view.scale_x * p[0]),
+                   (float)(view.offset_y + view.scale_y * p[1]));
+    }
+    rlEnd();
+    rlDrawRenderBatchActive();
+    rlEnableBackfaceCulling();
+}
+
+void plot_points(const Rectangle rect, const CoordPlane cp, Curve* curve)
+{
+    const ViewTransform view = coord_plane_view(rect, cp);
+    Color color = curve->color;
+    if (curve->implicit != NULL) {
+        plot_fill(view, curve->implicit, color);
+        // The boundary of a strict inequality is not part of it
+        if (curve->expr.relation == EXPR_LESS)
+            color.a /= 2;
+    }
+
+    // Live series change every frame, so they always go through decimation. The lines of a
+    // relation cannot be decimated by column and are always uploaded whole.
+    if ((curve->count <= MAX_GPU_POINTS && curve->tail == NULL) || curve->implicit != NULL) {
+        if (curve->dirty)
+            polyline_upload(&curve->line, curve->xs, curve->ys, NULL, curve->count);
+    } else {
+        // Reduce the visible points to at most five per pixel column so the cost of a frame
+        // depends on the window width and not on the size of the series
+        const double min_x = (rect.x - view.offset_x) / view.scale_x;
+        const double max_x = (rect.x + rect.width - view.offset_x) / view.scale_x;
+        const int columns = (int)ceilf(rect.width);
+        if (curve->dirty || min_x != curve->uploaded_min_x || max_x != curve->uploaded_max_x ||
+            columns != curve->uploaded_columns) {
+            if (5 * (size_t)columns + 2 > lod_capacity) {
+                lod_capacity = 5 * (size_t)columns + 2;
+                lod_indices = realloc(lod_indices, lod_capacity * sizeof(size_t));
+            }
+            size_t size;
+            if (curve_sorted(curve)) {
+                size = lod_decimate(&curve->lod, curve->xs, curve->ys, min_x, max_x, columns,
+                                    lod_indices);
+            } else {
+                // A file whose x values go back and forth keeps more points per column
+                while ((size = lod_decimate_unsorted(&curve->x_lod, &curve->lod, curve->xs,
+                                                     curve->ys, min_x, max_x, columns,
+                                                     lod_indices, lod_capacity)) == (size_t)-1) {
+                    lod_capacity *= 2;
+                    lod_indices = realloc(lod_indices, lod_capacity * sizeof(size_t));
+                }
+            }
+            polyline_upload(&curve->line, curve->xs, curve->ys, lod_indices, size);
+
+            curve->uploaded_min_x = min_x;
+            curve->uploaded_max_x = max_x;
+            curve->uploaded_columns = columns;
+        }
+    }
+    curve->dirty = false;
+
+    polyline_draw(&curve->line, view, LINE_THICKNESS, color);
+}
+
+// Expression curves are sampled half a screen width past each side of the view on the pool, and
+// relations one tile past each edge, so small pans only move the GPU transform
+bool curve_sample(Curve* curve, const Rectangle rect, const CoordPlane cp, ThreadPool* pool)
+{
+    if (curve->loader != NULL || curve->tail != NULL)
+        return false;
+
+    const ViewTransform view = coord_plane_view(rect, cp);
+    const double min_x = (rect.x - view.offset_x) / view.scale_x;
+    const double max_x = (rect.x + rect.width - view.offset_x) / view.scale_x;
+    if (curve->expr.relation != EXPR_EXPLICIT) {
+        if (curve->implicit == NULL) {
+            curve->implicit = malloc(sizeof(Implicit));
+            implicit_init(curve->implicit, &curve->expr);
+        }
+        // The y axis points up, so the bottom edge of the rectangle has the lowest y
+        const double min_y = (rect.y + rect.height - view.offset_y) / view.scale_y;
+        const double max_y = (rect.y - view.offset_y) / view.scale_y;
+        if (!implicit_update(curve->implicit, pool, min_x, max_x, min_y, max_y,
+                             1.0 / view.scale_x, 1.0 / fabs(view.scale_y)))
+            return false;
+
+        curve->xs = curve->implicit->xs;
+        curve->ys = curve->implicit->ys;
+        curve->count = curve->implicit->count;
+        curve->dirty = true;
+        return true;
+    }
+
+    if (curve->sampler.expr == NULL)
+        sampler_init(&curve->sampler, &curve->expr);
+    if (!sampler_update(&curve->sampler, pool, min_x, max_x, 1.0 / view.scale_x,
+                        1.0 / fabs(view.scale_y)))
+        return false;
+
+    curve->xs = curve->sampler.xs;
+    curve->ys = curve->sampler.ys;
+    curve->count = curve->sampler.count;
+    lod_build(&curve->lod, curve->ys, curve->count);
+    curve->dirty = true;
+    return true;
+}
+
+bool curve_pending(Curve* curve)
+{
+    return sampler_pending(&curve->sampler) ||
+           (curve->implicit != NULL && implicit_pending(curve->implicit));
+}
+
+bool curve_sorted(const Curve* curve)
+{
+    return curve->loader == NULL ||
+           atomic_load_explicit(&curve->loader->sorted, memory_order_relaxed);
+}
+
+// Picks up the samples a loader published since the last frame
+bool curve_poll(Curve* curve)
+{
+    if (curve->loader == NULL)
+        return false;
+
+    const size_t published =
+        atomic_load_explicit(&curve->loader->published, memory_order_acquire);
+    if (published == curve->count)
+        return false;
+
+    curve->xs = curve->loader->xs;
+    curve->ys = curve->loader->ys;
+    curve->count = published;
+    lod_extend(&curve->lod, curve->ys, published);
+    lod_extend(&curve->x_lod, curve->xs, published);
+    curve->dirty = true;
+    return true;
+}
+
+double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Latency of the samples drained from live series in the current frame, measured when it is
+// presented, and totals for the periodic report
+typedef struct
+{
+    size_t frame_count;
+    double frame_time_sum;
+    double frame_oldest;
+
+    size_t count;
+    size_t dropped;
+    double latency_sum;
+    double latency_max;
+    double report_time;
+} TailStats;
+
+static TailStats tail_stats = {.frame_oldest = INFINITY};
+static TailSample* tail_scratch = NULL;
+
+const size_t TAIL_RING_CAPACITY = 1 << 18;
+// Memory a live series may use for its samples unless --max-mb says otherwise
+const size_t TAIL_DEFAULT_MB = 64;
+
+// Moves the samples a live series received since the last frame into its columns. The columns
+// hold twice the window; when they are full the newest window is moved to the front, so each
+// sample is copied at most once more and memory stays bounded.
+bool curve_drain(Curve* curve)
+{
+    if (curve->tail == NULL)
+        return false;
+
+    if (tail_scratch == NULL)
+        tail_scratch = malloc(TAIL_RING_CAPACITY * sizeof(TailSample));
+    const size_t max = curve->window < TAIL_RING_CAPACITY ? curve->window : TAIL_RING_CAPACITY;
+    const size_t count = ring_pop(&curve->tail->ring, tail_scratch, max);
+    if (count == 0)
+        return false;
+
+    size_t begin = curve->count;
+    for (size_t i = 0; i < count; i++) {
+        const TailSample sample = tail_scratch[i];
+        tail_stats.frame_time_sum += sample.time;
+        tail_stats.frame_oldest = fmin(tail_stats.frame_oldest, sample.time);
+
+        // A producer that starts over (x going back) starts a new series
+        if (curve->count > 0 && sample.x < curve->xs[curve->count - 1]) {
+            curve->count = 0;
+            begin = 0;
+        }
+        if (curve->count == 2 * curve->window) {
+            memmove(curve->xs, curve->xs + curve->window, curve->window * sizeof(double));
+            memmove(curve->ys, curve->ys + curve->window, curve->window * sizeof(double));
+            curve->count = curve->window;
+            begin = 0;
+        }
+        curve->xs[curve->count] = sample.x;
+        curve->ys[curve->count] = sample.y;
+        curve->count++;
+    }
+    tail_stats.frame_count += count;
+
+    if (begin == 0)
+        lod_build(&curve->lod, curve->ys, curve->count);
+    else
+        lod_extend(&curve->lod, curve->ys, curve->count);
+    curve->dirty = true;
+    return true;
+}
+
+void curve_free(Curve* curve)
+{
+    if (curve->loader != NULL) {
+        loader_close(curve->loader);
+        free(curve->loader);
+    } else if (curve->implicit != NULL) {
+        implicit_free(curve->implicit);
+        free(curve->implicit);
+    } else if (curve->sampler.expr != NULL) {
+        sampler_free(&curve->sampler);
+    } else {
+        if (curve->tail != NULL) {
+            tail_close(curve->tail);
+            free(curve->tail);
+        }
+        free(curve->xs);
+        free(curve->ys);
+    }
+    lod_free(&curve->lod);
+    lod_free(&curve->x_lod);
+    polyline_unload(&curve->line);
+}
+
+// Called once a frame is presented: samples drained for it have now reached the screen. Prints
+// the throughput, drops and producer to screen latency of live series once a second.
+void tail_stats_present(const Curve* curves, size_t num_of_curves)
+{
+    const double present = now();
+    if (tail_stats.frame_count > 0) {
+        tail_stats.count += tail_stats.frame_count;
+        tail_stats.latency_sum += tail_stats.frame_count * present - tail_stats.frame_time_sum;
+        tail_stats.latency_max = fmax(tail_stats.latency_max, present - tail_stats.frame_oldest);
+        tail_stats.frame_count = 0;
+        tail_stats.frame_time_sum = 0;
+        tail_stats.frame_oldest = INFINITY;
+    }
+
+    if (tail_stats.report_time == 0)
+        tail_stats.report_time = present;
+    if (present - tail_stats.report_time < 1.0)
+        return;
+
+    size_t dropped = 0;
+    for (size_t i = 0; i < num_of_curves; i++) {
+        if (curves[i].tail != NULL)
+            dropped += atomic_load_explicit(&curves[i].tail->dropped, memory_order_relaxed);
+    }
+    const double elapsed = present - tail_stats.report_time;
+    printf("live: %.0f samples/s  dropped %zu  latency mean %.1f ms  max %.1f ms\n",
+           tail_stats.count / elapsed, dropped - tail_stats.dropped,
+           tail_stats.count > 0 ? tail_stats.latency_sum / tail_stats.count * 1e3 : 0.0,
+           tail_stats.latency_max * 1e3);
+
+    tail_stats.dropped = dropped;
+    tail_stats.count = 0;
+    tail_stats.latency_sum = 0;
+    tail_stats.latency_max = 0;
+    tail_stats.report_time = present;
+}
+
+// How far from a sample the cursor snaps to it, and how small a swing, in pixels, is not marked
+// as a minimum or maximum
+static const double HOVER_RADIUS = 24;
+static const double EXTREMUM_PIXELS = 8;
+#define MAX_MARKERS 256
+
+static Vector2 to_screen(const ViewTransform view, double x, double y)
+{
+    return (Vector2){(float)(view.offset_x + view.scale_x * x),
+                     (float)(view.offset_y + view.scale_y * y)};
+}
+
+// Queries need samples sorted by x with an up to date pyramid. The lines of a relation are not
+// sorted and have no pyramid.
+static bool curve_queryable(const Curve* curve)
+{
+    return curve->implicit == NULL && curve->count > 0 && curve->lod.count == curve->count &&
+           curve_sorted(curve);
+}
+
+static QuerySeries curve_series(const Curve* curve)
+{
+    return (QuerySeries){curve->xs, curve->ys, &curve->lod};
+}
+
+Hover hover_find(const Rectangle rect, const CoordPlane cp, const Curve* curves,
+                 size_t num_of_curves, Vector2 cursor)
+{
+    Hover hover = {0, QUERY_NONE};
+    if (!CheckCollisionPointRec(cursor, rect))
+        return hover;
+
+    // Each curve only has to beat the nearest sample found on the curves before it
+    const ViewTransform view = coord_plane_view(rect, cp);
+    double radius = HOVER_RADIUS;
+    for (size_t i = 0; i < num_of_curves; i++) {
+        const Curve* curve = &curves[i];
+        if (!curve_queryable(curve))
+            continue;
+        const size_t index = query_nearest(curve_series(curve), view, cursor.x, cursor.y, radius);
+        if (index == QUERY_NONE)
+            continue;
+        radius = Vector2Distance(to_screen(view, curve->xs[index], curve->ys[index]), cursor);
+        hover = (Hover){i, index};
+    }
+    return hover;
+}
+
+void hover_draw(const Rectangle rect, const CoordPlane cp, const Curve* curves, const Hover hover)
+{
+    if (hover.index == QUERY_NONE)
+        return;
+
+    const Curve* curve = &curves[hover.curve];
+    const double x = curve->xs[hover.index], y = curve->ys[hover.index];
+    const Vector2 point = to_screen(coord_plane_view(rect, cp), x, y);
+    DrawCircleV(point, POINT_THICKNESS + 2, curve->color);
+    DrawRing(point, POINT_THICKNESS + 2, POINT_THICKNESS + 3, 0, 360, 0, WHITE);
+
+    // Above and to the right of the sample, unless that leaves the plot
+    char text[64];
+    snprintf(text, sizeof(text), "(%.10g, %.10g)", x, y);
+    const Vector2 size = MeasureTextEx(font, text, font.baseSize, 0);
+    Vector2 position = {point.x + 10, point.y - 10 - size.y};
+    if (position.x + size.x > rect.x + rect.width)
+        position.x = point.x - 10 - size.x;
+    if (position.y < rect.y)
+        position.y = point.y + 10;
+    DrawRectangleV(position, size, BACKGROUND);
+    DrawTextEx(font, text, position, font.baseSize, 0, WHITE);
+}
+
+void plot_markers(const Rectangle rect, const CoordPlane cp, const Curve* curves,
+                  size_t num_of_curves, bool crossings, bool extrema)
+{
+    const ViewTransform view = coord_plane_view(rect, cp);
+    const double min_x = (rect.x - view.offset_x) / view.scale_x;
+    const double max_x = (rect.x + rect.width - view.offset_x) / view.scale_x;
+
+    for (size_t i = 0; crossings && i < num_of_curves; i++) {
+        for (size_t j = i + 1; j < num_of_curves; j++) {
+            if (!curve_queryable(&curves[i]) || !curve_queryable(&curves[j]))
+                continue;
+            QueryPoint points[MAX_MARKERS];
+            const size_t count = query_intersections(curve_series(&curves[i]),
+                                                     curve_series(&curves[j]), min_x, max_x,
+                                                     points, MAX_MARKERS);
+            for (size_t k = 0; k < count; k++)
+                DrawRing(to_screen(view, points[k].x, points[k].y), 5, 7, 0, 360, 0, WHITE);
+        }
+    }
+
+    // Triangles pointing up at maxima and down at minima
+    for (size_t i = 0; extrema && i < num_of_curves; i++) {
+        const Curve* curve = &curves[i];
+        if (!curve_queryable(curve))
+            continue;
+        QueryExtremum found[MAX_MARKERS];
+        const size_t count = query_extrema(curve_series(curve), min_x, max_x,
+                                           EXTREMUM_PIXELS / fabs(view.scale_y), found,
+                                           MAX_MARKERS);
+        for (size_t k = 0; k < count; k++) {
+            const size_t index = found[k].index;
+            DrawPoly(to_screen(view, curve->xs[index], curve->ys[index]), 3, 6,
+                     found[k].maximum ? -90 : 90, curve->color);
+        }
+    }
+}
+
+// Smallest 1, 2 or 5 times a power of ten that is at least `value`
+double nice_unit(double value)
+{
+    if (!(value > 0) || !isfinite(value))
+        return 1.0;
+    const double magnitude = pow(10.0, floor(log10(value)));
+    const double steps[] = {1, 2, 5, 10};
+    for (int i = 0; i < 4; i++) {
+        if (steps[i] * magnitude >= value)
+            return steps[i] * magnitude;
+    }
+    return 10 * magnitude;
+}
+
+// Centers the plane on the given world rectangle with units that make it fill the view
+void coord_plane_fit(CoordPlane* cp, const Rectangle rect, double min_x, double max_x,
+                     double min_y, double max_y)
+{
+    cp->unit_x = nice_unit((max_x - min_x) / cp->total_ticks.x);
+    cp->unit_y = nice_unit((max_y - min_y) / cp->total_ticks.y);
+    cp->offset_x = round((min_x + max_x) / 2.0 / cp->unit_x) * cp->unit_x;
+    cp->offset_y = round((min_y + max_y) / 2.0 / cp->unit_y) * cp->unit_y;
+    cp->origin = (Vector2){rect.x + rect.width / 2.0f, rect.y + rect.height / 2.0f};
+}
+
+// Fits the view to everything the data series loaded so far
+bool fit_to_data(CoordPlane* cp, const Rectangle rect, const Curve* curves, size_t num_of_curves)
+{
+    double min_x = INFINITY, max_x = -INFINITY, min_y = INFINITY, max_y = -INFINITY;
+    for (size_t i = 0; i < num_of_curves; i++) {
+        const Curve* curve = &curves[i];
+        if (curve->loader == NULL || curve->count == 0)
+            continue;
+
+        // The first and last x are only the extremes when the file is sorted
+        size_t imin, imax, xmin, xmax;
+        lod_range_minmax(&curve->lod, curve->ys, 0, curve->count, &imin, &imax);
+        lod_range_minmax(&curve->x_lod, curve->xs, 0, curve->count, &xmin, &xmax);
+        if (imin == (size_t)-1 || xmin == (size_t)-1)
+            continue;
+        min_x = fmin(min_x, curve->xs[xmin]);
+        max_x = fmax(max_x, curve->xs[xmax]);
+        min_y = fmin(min_y, curve->ys[imin]);
+        max_y = fmax(max_y, curve->ys[imax]);
+    }
+    if (min_x > max_x)
+        return false;
+
+    coord_plane_fit(cp, rect, min_x, max_x, min_y, max_y);
+    return true;
+}
+
+// Scrolls the plane so the newest sample of the live series sits near the right edge, and fits
+// the y axis to what is visible
+void follow_tail(CoordPlane* cp, const Rectangle rect, const Curve* curves, size_t num_of_curves)
+{
+    double newest = -INFINITY;
+    for (size_t i = 0; i < num_of_curves; i++) {
+        if (curves[i].tail != NULL && curves[i].count > 0)
+            newest = fmax(newest, curves[i].xs[curves[i].count - 1]);
+    }
+    if (newest == -INFINITY)
+        return;
+
+    // The origin stays near the middle, where the grid is drawn around, and its offset snaps to
+    // whole ticks so the labels stay round numbers while scrolling
+    const double right = rect.x + rect.width * 0.95;
+    const double scale_x = rect.width / cp->total_ticks.x / cp->unit_x;
+    const double center_x = newest - (right - rect.x - rect.width / 2.0) / scale_x;
+    cp->offset_x = round(center_x / cp->unit_x) * cp->unit_x;
+    cp->origin.x = (float)(right - scale_x * (newest - cp->offset_x));
+
+    const double min_x = newest - (right - rect.x) / scale_x;
+    double min_y = INFINITY, max_y = -INFINITY;
+    for (size_t i = 0; i < num_of_curves; i++) {
+        const Curve* curve = &curves[i];
+        if (curve->tail == NULL || curve->count == 0)
+            continue;
+
+        // First sample inside the window
+        size_t lo = 0, hi = curve->count;
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (curve->xs[mid] < min_x)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        size_t imin, imax;
+        lod_range_minmax(&curve->lod, curve->ys, lo, curve->count, &imin, &imax);
+        if (imin == (size_t)-1)
+            continue;
+        min_y = fmin(min_y, curve->ys[imin]);
+        max_y = fmax(max_y, curve->ys[imax]);
+    }
+    if (min_y > max_y)
+        return;
+
+    // Only refit y when the data leaves the view or shrinks to a small part of it, so the axis
+    // does not jitter every frame
+    const ViewTransform view = coord_plane_view(rect, *cp);
+    const double view_min_y = (rect.y + rect.height - view.offset_y) / view.scale_y;
+    const double view_max_y = (rect.y - view.offset_y) / view.scale_y;
+    const double span = fmax(max_y - min_y, 1e-9);
+    if (min_y < view_min_y || max_y > view_max_y || span < (view_max_y - view_min_y) / 8) {
+        const double middle = (min_y + max_y) / 2.0;
+        cp->unit_y = nice_unit(span * 1.25 / cp->total_ticks.y);
+        cp->offset_y = round(middle / cp->unit_y) * cp->unit_y;
+        const double scale_y = -(rect.height / cp->total_ticks.y) / cp->unit_y;
+        cp->origin.y = (float)(rect.y + rect.height / 2.0 - scale_y * (middle - cp->offset_y));
+    }
+}
+
+bool is_data_file(const char* arg, LoaderFormat* format)
+{
+    const char* ext = strrchr(arg, '.');
+    if (ext == NULL)
+        return false;
+    if (strcmp(ext, ".csv") == 0) {
+        *format = LOADER_CSV;
+        return true;
+    }
+    if (strcmp(ext, ".f64") == 0 || strcmp(ext, ".bin") == 0) {
+        *format = LOADER_F64;
+        return true;
+    }
+    return false;
+}
+
+PlotInput read_input(void)
+{
+    return (PlotInput){GetMouseWheelMove(), IsMouseButtonDown(MOUSE_BUTTON_LEFT), GetMouseDelta()};
+}
+
+// The next larger (or smaller) of 1, 2 or 5 times a power of ten, at most 2.5 times away
+static double step_unit(double unit, bool up)
+{
+    return nice_unit(unit * (up ? 1.5 : 0.3));
+}
+
+void update(CoordPlane* cp, const PlotInput input)
+{
+    float mouse_wheel = input.wheel;
+    const Vector2 ZOOM_DIFF_TO_TICKS_DIFF = {1, 1};
+    if (mouse_wheel < 0.0f) {
+        cp->ticks_per_quadrant = Vector2Add(cp->ticks_per_quadrant, ZOOM_DIFF_TO_TICKS_DIFF);
+    } else if (mouse_wheel > 0.0f) {
+        cp->ticks_per_quadrant = Vector2Subtract(cp->ticks_per_quadrant, ZOOM_DIFF_TO_TICKS_DIFF);
+    }
+
+    if (input.dragging) {
+        cp->origin = Vector2Add(cp->origin, input.drag);
+    }
+
+    // Past the minimum and maximum amounts of ticks per quadrant, step the units to the next
+    // 1, 2 or 5 times a power of ten instead so that zooming can go on without changing the
+    // visible range and the labels stay round numbers
+    const bool coarser = cp->ticks_per_quadrant.x > MAX_TICKS_PER_QUADRANT;
+    if (coarser || cp->ticks_per_quadrant.x < MIN_TICKS_PER_QUADRANT) {
+        const double unit_x = step_unit(cp->unit_x, coarser);
+        const double unit_y = step_unit(cp->unit_y, coarser);
+        const float ratio_x = (float)(cp->unit_x / unit_x);
+        cp->ticks_per_quadrant.x *= ratio_x;
+        cp->stretch_y *= (float)(cp->unit_y / unit_y) / ratio_x;
+        cp->unit_x = unit_x;
+        cp->unit_y = unit_y;
+    }
+
+    cp->ticks_per_quadrant.y = cp->stretch_y / ASPECT_RATIO() * cp->ticks_per_quadrant.x;
+    cp->total_ticks = Vector2Scale(cp->ticks_per_quadrant, 2.0f);
+
+    cp->min_x = -cp->ticks_per_quadrant.x;
+    cp->max_x = cp->ticks_per_quadrant.x;
+    cp->min_y = -cp->ticks_per_quadrant.y;
+    cp->max_y = cp->ticks_per_quadrant.y;
+
+    if (cp->ticks_per_quadrant.x > 35.0f) {
+        cp->tick_freq = 4;
+    } else if (cp->ticks_per_quadrant.x > 28.0f) {
+        cp->tick_freq = 3;
+    } else if (cp->ticks_per_quadrant.x > 15.0f) {
+        cp->tick_freq = 2;
+    } else if (cp->ticks_per_quadrant.x < 15.0f) {
+        cp->tick_freq = 1;
+    }
+}
+
+void plot_close(void)
+{
+    free(grid_labels);
+    grid_labels = NULL;
+    grid_label_capacity = 0;
+    free(lod_indices);
+    lod_indices = NULL;
+    lod_capacity = 0;
+    free(tail_scratch);
+    tail_scratch = NULL;
+}
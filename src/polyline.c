@@ -0,0 +1,179 @@
+#include "polyline.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "raymath.h"
+#include "rlgl.h"
+
+// Every instance is one segment. Its four attributes read consecutive points of the same buffer
+// (previous, start, end, next) so joins can be mitered without duplicating vertices.
+static const char* VERTEX_SHADER =
+    "#version 330\n"
+    "in vec2 pointPrev;\n"
+    "in vec2 pointA;\n"
+    "in vec2 pointB;\n"
+    "in vec2 pointNext;\n"
+    "uniform mat4 view;\n"
+    "uniform mat4 projection;\n"
+    "uniform float thickness;\n"
+    "bool invalid(vec2 p) { return any(isnan(p)) || any(isinf(p)); }\n"
+    "vec2 to_screen(vec2 p) { return (view * vec4(p, 0.0, 1.0)).xy; }\n"
+    "void main()\n"
+    "{\n"
+    "    if (invalid(pointA) || invalid(pointB)) {\n"
+    "        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "        return;\n"
+    "    }\n"
+    "    vec2 a = to_screen(pointA);\n"
+    "    vec2 b = to_screen(pointB);\n"
+    "    vec2 prev = invalid(pointPrev) ? a : to_screen(pointPrev);\n"
+    "    vec2 next = invalid(pointNext) ? b : to_screen(pointNext);\n"
+    "\n"
+    "    vec2 dir = length(b - a) > 1e-6 ? normalize(b - a) : vec2(1.0, 0.0);\n"
+    "    vec2 normal = vec2(-dir.y, dir.x);\n"
+    "\n"
+    "    // Two triangles: corners 1, 2 and 4 sit at the end of the segment\n"
+    "    bool at_end = gl_VertexID == 1 || gl_VertexID == 2 || gl_VertexID == 4;\n"
+    "    float side = (gl_VertexID == 2 || gl_VertexID == 4 || gl_VertexID == 5) ? 1.0 : -1.0;\n"
+    "    vec2 point = at_end ? b : a;\n"
+    "    vec2 other = at_end ? next - b : a - prev;\n"
+    "    vec2 other_dir = length(other) > 1e-6 ? normalize(other) : dir;\n"
+    "\n"
+    "    vec2 miter = normal + vec2(-other_dir.y, other_dir.x);\n"
+    "    miter = length(miter) > 1e-3 ? normalize(miter) : normal;\n"
+    "    float miter_scale = 1.0 / max(dot(miter, normal), 0.25);\n"
+    "    point += miter * side * thickness * 0.5 * miter_scale;\n"
+    "    gl_Position = projection * vec4(point, 0.0, 1.0);\n"
+    "}\n";
+
+static const char* FRAGMENT_SHADER =
+    "#version 330\n"
+    "uniform vec4 color;\n"
+    "out vec4 finalColor;\n"
+    "void main() { finalColor = color; }\n";
+
+static const char* ATTRIBUTES[4] = {"pointPrev", "pointA", "pointB", "pointNext"};
+
+static Shader shader;
+static int attribute_locs[4];
+static int view_loc, projection_loc, thickness_loc, color_loc;
+
+static float* scratch = NULL;
+static size_t scratch_capacity = 0;
+
+bool polyline_renderer_init(void)
+{
+    shader = LoadShaderFromMemory(VERTEX_SHADER, FRAGMENT_SHADER);
+    if (shader.id == rlGetShaderIdDefault())
+        return false;
+
+    for (int i = 0; i < 4; i++) {
+        attribute_locs[i] = GetShaderLocationAttrib(shader, ATTRIBUTES[i]);
+    }
+    view_loc = GetShaderLocation(shader, "view");
+    projection_loc = GetShaderLocation(shader, "projection");
+    thickness_loc = GetShaderLocation(shader, "thickness");
+    color_loc = GetShaderLocation(shader, "color");
+    return true;
+}
+
+void polyline_renderer_close(void)
+{
+    UnloadShader(shader);
+    free(scratch);
+    scratch = NULL;
+    scratch_capacity = 0;
+}
+
+void polyline_upload(Polyline* line, const double* xs, const double* ys, const size_t* indices,
+                     size_t count)
+{
+    // The first and last points are repeated so every segment has a previous and next point
+    const size_t padded = count + 2;
+    if (2 * padded > scratch_capacity) {
+        scratch_capacity = 2 * padded;
+        scratch = realloc(scratch, scratch_capacity * sizeof(float));
+    }
+
+    line->origin_x = 0;
+    line->origin_y = 0;
+    if (count > 0) {
+        const size_t mid = indices ? indices[count / 2] : count / 2;
+        line->origin_x = isfinite(xs[mid]) ? xs[mid] : 0;
+        line->origin_y = isfinite(ys[mid]) ? ys[mid] : 0;
+    }
+
+    for (size_t j = 0; j < count; j++) {
+        const size_t i = indices ? indices[j] : j;
+        const bool finite = isfinite(xs[i]) && isfinite(ys[i]);
+        scratch[2 * (j + 1)] = finite ? (float)(xs[i] - line->origin_x) : NAN;
+        scratch[2 * (j + 1) + 1] = finite ? (float)(ys[i] - line->origin_y) : NAN;
+    }
+    if (count > 0) {
+        scratch[0] = scratch[2];
+        scratch[1] = scratch[3];
+        scratch[2 * (count + 1)] = scratch[2 * count];
+        scratch[2 * (count + 1) + 1] = scratch[2 * count + 1];
+    }
+
+    if (padded > line->capacity) {
+        polyline_unload(line);
+        line->vao = rlLoadVertexArray();
+        rlEnableVertexArray(line->vao);
+        line->vbo = rlLoadVertexBuffer(scratch, (int)(2 * padded * sizeof(float)), true);
+        for (int k = 0; k < 4; k++) {
+            rlSetVertexAttribute(attribute_locs[k], 2, RL_FLOAT, false, 2 * sizeof(float),
+                                 (void*)(k * 2 * sizeof(float)));
+            rlSetVertexAttributeDivisor(attribute_locs[k], 1);
+            rlEnableVertexAttribute(attribute_locs[k]);
+        }
+        rlDisableVertexArray();
+        line->capacity = padded;
+    } else {
+        rlUpdateVertexBuffer(line->vbo, scratch, (int)(2 * padded * sizeof(float)), 0);
+    }
+    line->count = count;
+}
+
+void polyline_draw(const Polyline* line, ViewTransform view, float thickness, Color color)
+{
+    if (line->count < 2)
+        return;
+
+    // Fold the line origin into the translation in double precision
+    const Matrix view_matrix = {
+        (float)view.scale_x, 0, 0, (float)(view.offset_x + view.scale_x * line->origin_x),
+        0, (float)view.scale_y, 0, (float)(view.offset_y + view.scale_y * line->origin_y),
+        0, 0, 1, 0,
+        0, 0, 0, 1,
+    };
+    const Matrix projection = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    const Vector4 color_vec = ColorNormalize(color);
+
+    // Anything queued by the shapes/text functions has to be drawn first to keep the order
+    rlDrawRenderBatchActive();
+
+    rlEnableShader(shader.id);
+    rlSetUniformMatrix(view_loc, view_matrix);
+    rlSetUniformMatrix(projection_loc, projection);
+    rlSetUniform(thickness_loc, &thickness, RL_SHADER_UNIFORM_FLOAT, 1);
+    rlSetUniform(color_loc, &color_vec, RL_SHADER_UNIFORM_VEC4, 1);
+
+    rlEnableVertexArray(line->vao);
+    rlDrawVertexArrayInstanced(0, 6, (int)(line->count - 1));
+    rlDisableVertexArray();
+    rlDisableShader();
+}
+
+void polyline_unload(Polyline* line)
+{
+    if (line->vao != 0)
+        rlUnloadVertexArray(line->vao);
+    if (line->vbo != 0)
+        rlUnloadVertexBuffer(line->vbo);
+    line->vao = 0;
+    line->vbo = 0;
+    line->capacity = 0;
+    line->count = 0;
+}
@@ -0,0 +1,161 @@
+// sysconf() is not part of strict C17
+#define _DEFAULT_SOURCE
+
+#include "pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static int processor_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+static void deque_push(PoolDeque* deque, PoolTask task)
+{
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        const size_t capacity = deque->capacity == 0 ? 64 : 2 * deque->capacity;
+        PoolTask* tasks = malloc(capacity * sizeof(PoolTask));
+        for (size_t i = 0; i < deque->count; i++)
+            tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+        deque->head = 0;
+    }
+    deque->tasks[(deque->head + deque->count) % deque->capacity] = task;
+    deque->count++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static bool deque_take(PoolDeque* deque, bool from_back, PoolTask* task)
+{
+    pthread_mutex_lock(&deque->lock);
+    const bool found = deque->count > 0;
+    if (found) {
+        if (from_back) {
+            *task = deque->tasks[(deque->head + deque->count - 1) % deque->capacity];
+        } else {
+            *task = deque->tasks[deque->head];
+            deque->head = (deque->head + 1) % deque->capacity;
+        }
+        deque->count--;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+typedef struct
+{
+    ThreadPool* pool;
+    int index;
+} WorkerArg;
+
+static bool find_task(ThreadPool* pool, int self, PoolTask* task)
+{
+    if (deque_take(&pool->deques[self], false, task))
+        return true;
+    for (int i = 1; i < pool->num_of_workers; i++) {
+        if (deque_take(&pool->deques[(self + i) % pool->num_of_workers], true, task))
+            return true;
+    }
+    return false;
+}
+
+static void* worker(void* arg)
+{
+    WorkerArg* worker_arg = arg;
+    ThreadPool* pool = worker_arg->pool;
+    const int self = worker_arg->index;
+    free(worker_arg);
+
+    for (;;) {
+        PoolTask task;
+        if (find_task(pool, self, &task)) {
+            atomic_fetch_sub(&pool->queued, 1);
+            task.fn(task.arg);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->sleep_lock);
+        while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->stop))
+            pthread_cond_wait(&pool->wake, &pool->sleep_lock);
+        const bool done = atomic_load(&pool->queued) == 0 && atomic_load(&pool->stop);
+        pthread_mutex_unlock(&pool->sleep_lock);
+        if (done)
+            return NULL;
+    }
+}
+
+bool pool_init(ThreadPool* pool, int num_of_workers)
+{
+    memset(pool, 0, sizeof(*pool));
+    if (num_of_workers <= 0)
+        num_of_workers = processor_count() - 1;
+    if (num_of_workers < 1)
+        num_of_workers = 1;
+    if (num_of_workers > POOL_MAX_WORKERS)
+        num_of_workers = POOL_MAX_WORKERS;
+
+    pthread_mutex_init(&pool->sleep_lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    for (int i = 0; i < POOL_MAX_WORKERS; i++)
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+
+    pool->num_of_workers = num_of_workers;
+    for (int i = 0; i < num_of_workers; i++) {
+        WorkerArg* arg = malloc(sizeof(WorkerArg));
+        *arg = (WorkerArg){pool, i};
+        if (pthread_create(&pool->threads[i], NULL, worker, arg) != 0) {
+            free(arg);
+            pool->num_of_workers = i;
+            pool_close(pool);
+            return false;
+        }
+    }
+    return true;
+}
+
+void pool_close(ThreadPool* pool)
+{
+    pthread_mutex_lock(&pool->sleep_lock);
+    atomic_store(&pool->stop, true);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->sleep_lock);
+
+    for (int i = 0; i < pool->num_of_workers; i++)
+        pthread_join(pool->threads[i], NULL);
+    for (int i = 0; i < POOL_MAX_WORKERS; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->sleep_lock);
+    pool->num_of_workers = 0;
+}
+
+void pool_submit(ThreadPool* pool, PoolTaskFn fn, void* arg)
+{
+    // Counted before the push so a worker that takes the task right away never sees it at zero
+    atomic_fetch_add(&pool->queued, 1);
+    const unsigned index = atomic_fetch_add(&pool->next, 1) % (unsigned)pool->num_of_workers;
+    deque_push(&pool->deques[index], (PoolTask){fn, arg});
+
+    pthread_mutex_lock(&pool->sleep_lock);
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->sleep_lock);
+}
@@ -0,0 +1,357 @@
+#include "query.h"
+
+#include <math.h>
+
+// Ranges with at most this many samples of both series are walked instead of halved again
+#define SCAN_POINTS 256
+
+// First index in [lo, hi) whose x is >= value (or > value when `inclusive` is false)
+static size_t search(const double* xs, size_t lo, size_t hi, double value, bool inclusive)
+{
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (inclusive ? xs[mid] < value : xs[mid] <= value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// The cursor in world coordinates, pixels per world unit, and the best sample so far with its
+// squared distance in pixels
+typedef struct
+{
+    QuerySeries series;
+    double x;
+    double y;
+    double scale_x;
+    double scale_y;
+    double best;
+    size_t index;
+} Nearest;
+
+static double gap(double value, double lo, double hi)
+{
+    return value < lo ? lo - value : (value > hi ? value - hi : 0);
+}
+
+// Squared distance in pixels from the cursor to the bounding box of block `b` at level `l`
+static double block_distance(const Nearest* q, int l, size_t b)
+{
+    const LodPyramid* lod = q->series.lod;
+    const size_t imin = lod->min_index[l][b], imax = lod->max_index[l][b];
+    if (imin == QUERY_NONE)
+        return INFINITY;
+
+    const size_t size = (size_t)LOD_BLOCK << l, first = b * size;
+    const double dx = gap(q->x, q->series.xs[first], q->series.xs[first + size - 1]) * q->scale_x;
+    const double dy = gap(q->y, q->series.ys[imin], q->series.ys[imax]) * q->scale_y;
+    return dx * dx + dy * dy;
+}
+
+static void scan_nearest(Nearest* q, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        if (!isfinite(q->series.ys[i]))
+            continue;
+        const double dx = (q->series.xs[i] - q->x) * q->scale_x;
+        const double dy = (q->series.ys[i] - q->y) * q->scale_y;
+        if (dx * dx + dy * dy < q->best) {
+            q->best = dx * dx + dy * dy;
+            q->index = i;
+        }
+    }
+}
+
+// Descends into the nearer half first, so the farther one is usually ruled out by its box
+static void visit_nearest(Nearest* q, int l, size_t b, double distance)
+{
+    if (distance >= q->best)
+        return;
+    if (l == 0) {
+        scan_nearest(q, b * LOD_BLOCK, (b + 1) * LOD_BLOCK);
+        return;
+    }
+
+    const double left = block_distance(q, l - 1, 2 * b);
+    const double right = block_distance(q, l - 1, 2 * b + 1);
+    if (left <= right) {
+        visit_nearest(q, l - 1, 2 * b, left);
+        visit_nearest(q, l - 1, 2 * b + 1, right);
+    } else {
+        visit_nearest(q, l - 1, 2 * b + 1, right);
+        visit_nearest(q, l - 1, 2 * b, left);
+    }
+}
+
+size_t query_nearest(QuerySeries series, ViewTransform view, double screen_x, double screen_y,
+                     double radius)
+{
+    Nearest q = {
+        series,
+        (screen_x - view.offset_x) / view.scale_x,
+        (screen_y - view.offset_y) / view.scale_y,
+        fabs(view.scale_x),
+        fabs(view.scale_y),
+        radius * radius,
+        QUERY_NONE,
+    };
+
+    // The samples past the last full block, then the blocks of each level that are not part of a
+    // block of the level above, nearest first
+    const LodPyramid* lod = series.lod;
+    scan_nearest(&q, lod->levels > 0 ? lod->blocks[0] * LOD_BLOCK : 0, lod->count);
+
+    int root_levels[LOD_MAX_LEVELS];
+    size_t root_blocks[LOD_MAX_LEVELS];
+    double root_distances[LOD_MAX_LEVELS];
+    int num_of_roots = 0;
+    for (int l = lod->levels - 1; l >= 0; l--) {
+        const size_t covered = l + 1 < lod->levels ? 2 * lod->blocks[l + 1] : 0;
+        for (size_t b = covered; b < lod->blocks[l] && num_of_roots < LOD_MAX_LEVELS; b++) {
+            const double distance = block_distance(&q, l, b);
+            int i = num_of_roots++;
+            for (; i > 0 && root_distances[i - 1] > distance; i--) {
+                root_levels[i] = root_levels[i - 1];
+                root_blocks[i] = root_blocks[i - 1];
+                root_distances[i] = root_distances[i - 1];
+            }
+            root_levels[i] = l;
+            root_blocks[i] = b;
+            root_distances[i] = distance;
+        }
+    }
+    for (int i = 0; i < num_of_roots; i++)
+        visit_nearest(&q, root_levels[i], root_blocks[i], root_distances[i]);
+    return q.index;
+}
+
+typedef struct
+{
+    QuerySeries a;
+    QuerySeries b;
+    QueryPoint* out;
+    size_t max;
+    size_t len;
+} Crossings;
+
+// The samples whose segments reach into [x0, x1]: [*begin, *end)
+static void span(QuerySeries s, double x0, double x1, size_t* begin, size_t* end)
+{
+    const size_t n = s.lod->count;
+    const size_t first = search(s.xs, 0, n, x0, true);
+    const size_t last = search(s.xs, first, n, x1, false);
+    *begin = first > 0 ? first - 1 : 0;
+    *end = last < n ? last + 1 : n;
+}
+
+// The line through the samples at x coming from the left, where xs[k - 1] < x <= xs[k]
+static double line_before(QuerySeries s, size_t k, double x)
+{
+    if (s.xs[k] == x)
+        return s.ys[k];
+    const double t = (x - s.xs[k - 1]) / (s.xs[k] - s.xs[k - 1]);
+    return s.ys[k - 1] + t * (s.ys[k] - s.ys[k - 1]);
+}
+
+// The same leaving x to the right, where xs[k - 1] <= x < xs[k]. Samples that share an x value
+// make a vertical step, so the two differ there.
+static double line_after(QuerySeries s, size_t k, double x)
+{
+    if (s.xs[k - 1] == x)
+        return s.ys[k - 1];
+    const double t = (x - s.xs[k - 1]) / (s.xs[k] - s.xs[k - 1]);
+    return s.ys[k - 1] + t * (s.ys[k] - s.ys[k - 1]);
+}
+
+static bool opposite(double a, double b)
+{
+    return (a < 0 && b > 0) || (a > 0 && b < 0);
+}
+
+// Both lines are straight between consecutive sample x values of either series, so the
+// difference changes sign at most once in each such interval, plus once in a step at its end
+static void walk_crossings(Crossings* c, double x0, double x1)
+{
+    const QuerySeries a = c->a, b = c->b;
+    const size_t na = a.lod->count, nb = b.lod->count;
+    double u = fmax(x0, fmax(a.xs[0], b.xs[0]));
+    const double end = fmin(x1, fmin(a.xs[na - 1], b.xs[nb - 1]));
+    if (!(u < end))
+        return;
+
+    size_t i = search(a.xs, 0, na, u, false), j = search(b.xs, 0, nb, u, false);
+    double ya = line_after(a, i, u), du = ya - line_after(b, j, u);
+    while (u < end && c->len < c->max) {
+        const double v = fmin(end, fmin(a.xs[i], b.xs[j]));
+        const double yb = line_before(a, i, v), dv = yb - line_before(b, j, v);
+        if (du == 0) {
+            c->out[c->len++] = (QueryPoint){u, ya};
+        } else if (opposite(du, dv)) {
+            const double t = du / (du - dv);
+            c->out[c->len++] = (QueryPoint){u + t * (v - u), ya + t * (yb - ya)};
+        }
+
+        while (i < na && a.xs[i] <= v)
+            i++;
+        while (j < nb && b.xs[j] <= v)
+            j++;
+        const double ya_after = line_after(a, i, v), dv_after = ya_after - line_after(b, j, v);
+
+        // A crossing exactly at x1 belongs to the next range
+        if (v < end && c->len < c->max && dv_after != 0 && (dv == 0 || opposite(dv, dv_after))) {
+            const double t = dv / (dv - dv_after);
+            c->out[c->len++] = (QueryPoint){v, yb + t * (ya_after - yb)};
+        }
+        u = v;
+        ya = ya_after;
+        du = dv_after;
+    }
+}
+
+static void find_crossings(Crossings* c, double x0, double x1)
+{
+    if (c->len == c->max)
+        return;
+
+    // The lines over [x0, x1] stay within the extremes of the samples they pass through
+    size_t a_begin, a_end, b_begin, b_end, a_min, a_max, b_min, b_max;
+    span(c->a, x0, x1, &a_begin, &a_end);
+    span(c->b, x0, x1, &b_begin, &b_end);
+    lod_range_minmax(c->a.lod, c->a.ys, a_begin, a_end, &a_min, &a_max);
+    lod_range_minmax(c->b.lod, c->b.ys, b_begin, b_end, &b_min, &b_max);
+    if (a_min == QUERY_NONE || b_min == QUERY_NONE || c->a.ys[a_max] < c->b.ys[b_min] ||
+        c->b.ys[b_max] < c->a.ys[a_min])
+        return;
+
+    const double mid = x0 + (x1 - x0) / 2;
+    if ((a_end - a_begin) + (b_end - b_begin) <= SCAN_POINTS || !(x0 < mid && mid < x1)) {
+        walk_crossings(c, x0, x1);
+        return;
+    }
+    find_crossings(c, x0, mid);
+    find_crossings(c, mid, x1);
+}
+
+size_t query_intersections(QuerySeries a, QuerySeries b, double min_x, double max_x,
+                           QueryPoint* out, size_t max)
+{
+    if (a.lod->count == 0 || b.lod->count == 0 || !(min_x < max_x))
+        return 0;
+
+    Crossings c = {a, b, out, max, 0};
+    find_crossings(&c, min_x, max_x);
+    return c.len;
+}
+
+// The zigzag between two turns. Until the first swing `trend` is 0 and the low and the high so
+// far both stay candidates; then a rising run keeps its high and a falling run its low.
+typedef struct
+{
+    double prominence;
+    int trend;
+    size_t low;
+    size_t high;
+} Zigzag;
+
+// Whether block `b` at level `l` can hold no turn. If so, moves the low or high to the block's.
+static bool skip_block(const LodPyramid* lod, const double* ys, int l, size_t b, Zigzag* z)
+{
+    const size_t imin = lod->min_index[l][b], imax = lod->max_index[l][b];
+    if (imin == QUERY_NONE)
+        return true;
+    const double lo = ys[imin], hi = ys[imax];
+    if (z->trend == 0   ? fmax(ys[z->high], hi) - fmin(ys[z->low], lo) > z->prominence
+        : z->trend > 0 ? lo < fmax(ys[z->high], hi) - z->prominence
+                       : hi > fmin(ys[z->low], lo) + z->prominence)
+        return false;
+    if (z->trend >= 0 && hi > ys[z->high])
+        z->high = imax;
+    if (z->trend <= 0 && lo < ys[z->low])
+        z->low = imin;
+    return true;
+}
+
+// Whether the zigzag turns at sample i: the first swing of more than `prominence`, a rising run
+// dropping that far below its high, or a falling run rising that far above its low
+static bool turns_at(const double* ys, size_t i, Zigzag* z)
+{
+    const double y = ys[i];
+    if (z->trend >= 0 && y > ys[z->high])
+        z->high = i;
+    else if (z->trend <= 0 && y < ys[z->low])
+        z->low = i;
+    else if (z->trend > 0)
+        return y < ys[z->high] - z->prominence;
+    else if (z->trend < 0)
+        return y > ys[z->low] + z->prominence;
+    return z->trend == 0 && ys[z->high] - ys[z->low] > z->prominence;
+}
+
+// Follows the zigzag to the first sample in [begin, end) where it turns. Like lod_find_outside(),
+// blocks that cannot hold the turn are skipped whole, so the new lows and highs along the way do
+// not cost a search each.
+static size_t find_turn(const LodPyramid* lod, const double* ys, size_t begin, size_t end,
+                        Zigzag* z)
+{
+    size_t i = begin;
+    while (i < end) {
+        if (i % LOD_BLOCK == 0 && end - i >= LOD_BLOCK) {
+            int l = 0;
+            size_t b = i / LOD_BLOCK;
+            while (l + 1 < lod->levels && b % 2 == 0 && b / 2 < lod->blocks[l + 1] &&
+                   i + ((size_t)LOD_BLOCK << (l + 1)) <= end) {
+                l++;
+                b /= 2;
+            }
+            while (l >= 0 && !skip_block(lod, ys, l, b, z)) {
+                l--;
+                b *= 2;
+            }
+            if (l >= 0) {
+                i += (size_t)LOD_BLOCK << l;
+                continue;
+            }
+        }
+
+        // Sample by sample up to the next block boundary
+        for (const size_t next = (i / LOD_BLOCK + 1) * LOD_BLOCK; i < next && i < end; i++) {
+            if (turns_at(ys, i, z))
+                return i;
+        }
+    }
+    return QUERY_NONE;
+}
+
+size_t query_extrema(QuerySeries series, double min_x, double max_x, double prominence,
+                     QueryExtremum* out, size_t max)
+{
+    const double* ys = series.ys;
+    const size_t n = series.lod->count;
+    size_t at = search(series.xs, 0, n, min_x, true);
+    const size_t end = search(series.xs, at, n, max_x, false);
+    while (at < end && !isfinite(ys[at]))
+        at++;
+    if (at == end || max == 0)
+        return 0;
+
+    // The first swing sets the direction, then the extremes alternate: a rising run ends at its
+    // high once it drops far enough
+    Zigzag z = {prominence, 0, at, at};
+    at = find_turn(series.lod, ys, at + 1, end, &z);
+    if (at == QUERY_NONE)
+        return 0;
+    z.trend = z.high > z.low ? 1 : -1;
+    size_t len = 0;
+    out[len++] = z.trend > 0 ? (QueryExtremum){z.low, false} : (QueryExtremum){z.high, true};
+    while (len < max) {
+        at = find_turn(series.lod, ys, at + 1, end, &z);
+        if (at == QUERY_NONE)
+            break;
+        out[len++] = z.trend > 0 ? (QueryExtremum){z.high, true} : (QueryExtremum){z.low, false};
+        z.low = z.high = at;
+        z.trend = -z.trend;
+    }
+    return len;
+}
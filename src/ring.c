@@ -0,0 +1,73 @@
+#include "ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool ring_init(SampleRing* ring, size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->items = malloc(size * sizeof(TailSample));
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return ring->items != NULL;
+}
+
+void ring_free(SampleRing* ring)
+{
+    free(ring->items);
+    ring->items = NULL;
+}
+
+// Copies `count` samples starting at ring position `index`, wrapping around the end of the array
+static void copy_in(SampleRing* ring, size_t index, const TailSample* samples, size_t count)
+{
+    const size_t start = index & ring->mask;
+    const size_t first = count < ring->mask + 1 - start ? count : ring->mask + 1 - start;
+    memcpy(ring->items + start, samples, first * sizeof(TailSample));
+    memcpy(ring->items, samples + first, (count - first) * sizeof(TailSample));
+}
+
+static void copy_out(const SampleRing* ring, size_t index, TailSample* out, size_t count)
+{
+    const size_t start = index & ring->mask;
+    const size_t first = count < ring->mask + 1 - start ? count : ring->mask + 1 - start;
+    memcpy(out, ring->items + start, first * sizeof(TailSample));
+    memcpy(out + first, ring->items, (count - first) * sizeof(TailSample));
+}
+
+size_t ring_push(SampleRing* ring, const TailSample* samples, size_t count)
+{
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const size_t size = ring->mask + 1;
+
+    // Only look at the consumer's index again when the cached one says the ring is full
+    if (size - (head - ring->cached_tail) < count)
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    const size_t space = size - (head - ring->cached_tail);
+    if (count > space)
+        count = space;
+
+    copy_in(ring, head, samples, count);
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    return count;
+}
+
+size_t ring_pop(SampleRing* ring, TailSample* out, size_t max)
+{
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (ring->cached_head - tail < max)
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t count = ring->cached_head - tail;
+    if (count > max)
+        count = max;
+
+    copy_out(ring, tail, out, count);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
@@ -0,0 +1,429 @@
+#include "sampler.h"
+
+#include <math.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Deviation from a straight line, in pixels, above which a segment is split
+#define TOLERANCE 0.5
+// Rise between two base samples, in pixels, above which a segment is checked even when the curve
+// looks straight there
+#define STEEP 4.0
+
+typedef enum
+{
+    KNOWN_NONE,
+    KNOWN_EVEN, // Samples at even base steps came from the level above
+    KNOWN_ALL,
+} Known;
+
+typedef struct
+{
+    Sampler* sampler;
+    SampleChunk* chunk;
+    Known known;
+    double base[SAMPLER_CHUNK + 1];
+} SampleJob;
+
+typedef struct
+{
+    double xa, ya, xb, yb;
+} Segment;
+
+typedef struct
+{
+    double x, y;
+} Point;
+
+static int compare_points(const void* a, const void* b)
+{
+    const double x = ((const Point*)a)->x, y = ((const Point*)b)->x;
+    return (x > y) - (x < y);
+}
+
+static bool needs_split(double ya, double ym, double yb, double tolerance)
+{
+    if (isfinite(ya) != isfinite(yb) || isfinite(ya) != isfinite(ym))
+        return true;
+    return fabs(ym - (ya + yb) / 2.0) > tolerance;
+}
+
+static void sample_chunk(void* arg)
+{
+    SampleJob* job = arg;
+    SampleChunk* chunk = job->chunk;
+    const Expr* expr = job->sampler->expr;
+    const double step = ldexp(1.0, chunk->level);
+    const double pixel_y = ldexp(1.0, chunk->y_level);
+    const long long first = chunk->index * SAMPLER_CHUNK;
+    size_t evaluations = 0;
+
+    // Base grid. The x values are integers times a power of two, so they are exact and the
+    // samples shared between levels are bit for bit the same.
+    double xs[SAMPLER_CHUNK + 1];
+    for (int i = 0; i <= SAMPLER_CHUNK; i++)
+        xs[i] = (double)(first + i) * step;
+
+    memcpy(chunk->base, job->base, sizeof(chunk->base));
+    if (job->known == KNOWN_NONE) {
+        expr_eval(expr, xs, chunk->base, SAMPLER_CHUNK + 1);
+        evaluations += SAMPLER_CHUNK + 1;
+    } else if (job->known == KNOWN_EVEN) {
+        double odd_xs[SAMPLER_CHUNK / 2], odd_ys[SAMPLER_CHUNK / 2];
+        for (int i = 0; i < SAMPLER_CHUNK / 2; i++)
+            odd_xs[i] = xs[2 * i + 1];
+        expr_eval(expr, odd_xs, odd_ys, SAMPLER_CHUNK / 2);
+        for (int i = 0; i < SAMPLER_CHUNK / 2; i++)
+            chunk->base[2 * i + 1] = odd_ys[i];
+        evaluations += SAMPLER_CHUNK / 2;
+    }
+    const double* ys = chunk->base;
+
+    // Segments that bend, rise steeply or cross into undefined territory are halved, in rounds
+    // so that each round evaluates all of its midpoints in one batch
+    size_t capacity = 2 * SAMPLER_CHUNK, num_of_points = 0;
+    Point* points = malloc(capacity * sizeof(Point));
+    Segment* segments = malloc(SAMPLER_CHUNK * sizeof(Segment));
+    size_t num_of_segments = 0;
+    const double tolerance = TOLERANCE * pixel_y;
+    for (int i = 0; i < SAMPLER_CHUNK; i++) {
+        points[num_of_points++] = (Point){xs[i], ys[i]};
+
+        // Second differences at both ends of the segment. Comparisons with NaN are false, so
+        // stretches where the function is undefined are left alone.
+        const bool bends = (i > 0 && fabs(ys[i - 1] - 2 * ys[i] + ys[i + 1]) > tolerance) ||
+                           (i + 2 <= SAMPLER_CHUNK &&
+                            fabs(ys[i] - 2 * ys[i + 1] + ys[i + 2]) > tolerance);
+        if (bends || isfinite(ys[i]) != isfinite(ys[i + 1]) ||
+            fabs(ys[i + 1] - ys[i]) > STEEP * pixel_y)
+            segments[num_of_segments++] = (Segment){xs[i], ys[i], xs[i + 1], ys[i + 1]};
+    }
+
+    for (int depth = 1; depth <= SAMPLER_MAX_DEPTH && num_of_segments > 0; depth++) {
+        double* mid_xs = malloc(num_of_segments * sizeof(double));
+        double* mid_ys = malloc(num_of_segments * sizeof(double));
+        for (size_t i = 0; i < num_of_segments; i++)
+            mid_xs[i] = (segments[i].xa + segments[i].xb) / 2.0;
+        expr_eval(expr, mid_xs, mid_ys, num_of_segments);
+        evaluations += num_of_segments;
+
+        // Each segment adds its midpoint and possibly a break, then splits into at most two
+        if (num_of_points + 2 * num_of_segments > capacity) {
+            capacity = 2 * (num_of_points + 2 * num_of_segments);
+            points = realloc(points, capacity * sizeof(Point));
+        }
+        Segment* next = malloc(2 * num_of_segments * sizeof(Segment));
+        size_t num_of_next = 0;
+        for (size_t i = 0; i < num_of_segments; i++) {
+            const Segment s = segments[i];
+            const double xm = mid_xs[i], ym = mid_ys[i];
+            points[num_of_points++] = (Point){xm, ym};
+
+            const bool split = needs_split(s.ya, ym, s.yb, tolerance);
+            if (depth < SAMPLER_MAX_DEPTH) {
+                if (split) {
+                    next[num_of_next++] = (Segment){s.xa, s.ya, xm, ym};
+                    next[num_of_next++] = (Segment){xm, ym, s.xb, s.yb};
+                }
+                continue;
+            }
+
+            // At the finest level a continuous curve is close to straight, while across a jump
+            // the midpoint stays next to one end. Break the line on the side of the jump.
+            const double rise = fabs(s.yb - s.ya);
+            if (rise > STEEP * pixel_y && fabs(ym - (s.ya + s.yb) / 2.0) > rise / 4.0) {
+                const double x = fabs(ym - s.ya) < fabs(ym - s.yb) ? (xm + s.xb) / 2.0
+                                                                   : (s.xa + xm) / 2.0;
+                points[num_of_points++] = (Point){x, NAN};
+            }
+        }
+        free(mid_xs);
+        free(mid_ys);
+        free(segments);
+        segments = next;
+        num_of_segments = num_of_next;
+    }
+    free(segments);
+
+    qsort(points, num_of_points, sizeof(Point), compare_points);
+    chunk->xs = malloc(num_of_points * sizeof(double));
+    chunk->ys = malloc(num_of_points * sizeof(double));
+    for (size_t i = 0; i < num_of_points; i++) {
+        chunk->xs[i] = points[i].x;
+        chunk->ys[i] = points[i].y;
+    }
+    chunk->count = num_of_points;
+    free(points);
+
+    Sampler* sampler = job->sampler;
+    free(job);
+    atomic_fetch_add_explicit(&sampler->evaluations, evaluations, memory_order_relaxed);
+    atomic_store_explicit(&chunk->state, CHUNK_READY, memory_order_release);
+    atomic_fetch_sub_explicit(&sampler->jobs, 1, memory_order_release);
+}
+
+void sampler_init(Sampler* sampler, const Expr* expr)
+{
+    memset(sampler, 0, sizeof(*sampler));
+    sampler->expr = expr;
+    for (int i = 0; i < SAMPLER_CACHE; i++)
+        atomic_init(&sampler->chunks[i].state, CHUNK_EMPTY);
+    atomic_init(&sampler->jobs, 0);
+    atomic_init(&sampler->evaluations, 0);
+}
+
+void sampler_free(Sampler* sampler)
+{
+    while (atomic_load_explicit(&sampler->jobs, memory_order_acquire) > 0)
+        sched_yield();
+    for (int i = 0; i < SAMPLER_CACHE; i++) {
+        free(sampler->chunks[i].xs);
+        free(sampler->chunks[i].ys);
+    }
+    free(sampler->xs);
+    free(sampler->ys);
+    memset(sampler, 0, sizeof(*sampler));
+}
+
+bool sampler_pending(Sampler* sampler)
+{
+    return atomic_load_explicit(&sampler->jobs, memory_order_acquire) > 0;
+}
+
+// Most chunks one request covers: the view and half a view on each side
+#define MAX_RANGE (SAMPLER_CACHE / 2)
+
+// The cached chunks around a request, gathered in one pass over the cache
+typedef struct
+{
+    int level;
+    int y_level;
+    long long first;
+    long long last;
+    SampleChunk* current[MAX_RANGE];         // Same level and y pixel size, in any state
+    SampleChunk* same[MAX_RANGE];            // Same level, ready
+    SampleChunk* parents[MAX_RANGE / 2 + 2]; // One level up, ready
+    SampleChunk* children[2 * MAX_RANGE];    // One level down, ready
+} Neighbourhood;
+
+static long long floor_div2(long long value)
+{
+    return value >= 0 ? value / 2 : -((-value + 1) / 2);
+}
+
+static void gather(Sampler* sampler, Neighbourhood* n)
+{
+    memset(n->current, 0, sizeof(n->current));
+    memset(n->same, 0, sizeof(n->same));
+    memset(n->parents, 0, sizeof(n->parents));
+    memset(n->children, 0, sizeof(n->children));
+
+    for (int i = 0; i < SAMPLER_CACHE; i++) {
+        SampleChunk* chunk = &sampler->chunks[i];
+        const int state = atomic_load_explicit(&chunk->state, memory_order_acquire);
+        if (state == CHUNK_EMPTY)
+            continue;
+
+        const long long index = chunk->index;
+        if (chunk->level == n->level && index >= n->first && index <= n->last) {
+            if (chunk->y_level == n->y_level) {
+                // Keeps the chunk from being evicted while this request fills the range
+                chunk->last_used = sampler->frame;
+                n->current[index - n->first] = chunk;
+            } else if (state == CHUNK_READY) {
+                n->same[index - n->first] = chunk;
+            }
+        } else if (state != CHUNK_READY) {
+            continue;
+        } else if (chunk->level == n->level + 1 && index >= floor_div2(n->first) &&
+                   index <= floor_div2(n->last)) {
+            n->parents[index - floor_div2(n->first)] = chunk;
+        } else if (chunk->level == n->level - 1 && index >= 2 * n->first &&
+                   index <= 2 * n->last + 1) {
+            n->children[index - 2 * n->first] = chunk;
+        }
+    }
+}
+
+// A chunk found by gather() that is still what it was; requests before this one may have
+// evicted it and queued it somewhere else
+static const SampleChunk* valid(const SampleChunk* chunk, int level, long long index)
+{
+    if (chunk == NULL || chunk->level != level || chunk->index != index ||
+        atomic_load_explicit(&chunk->state, memory_order_acquire) != CHUNK_READY)
+        return NULL;
+    return chunk;
+}
+
+// An unused slot, or the least recently used ready chunk that the current view does not need
+static SampleChunk* evict(Sampler* sampler)
+{
+    SampleChunk* oldest = NULL;
+    for (int i = 0; i < SAMPLER_CACHE; i++) {
+        SampleChunk* chunk = &sampler->chunks[i];
+        const int state = atomic_load_explicit(&chunk->state, memory_order_acquire);
+        if (state == CHUNK_EMPTY)
+            return chunk;
+        if (state == CHUNK_READY && chunk->last_used != sampler->frame &&
+            (oldest == NULL || chunk->last_used < oldest->last_used))
+            oldest = chunk;
+    }
+    if (oldest != NULL) {
+        free(oldest->xs);
+        free(oldest->ys);
+        oldest->xs = oldest->ys = NULL;
+        oldest->count = 0;
+    }
+    return oldest;
+}
+
+static void request(Sampler* sampler, ThreadPool* pool, Neighbourhood* n, long long index)
+{
+    if (n->current[index - n->first] != NULL)
+        return;
+
+    // Copy the base samples to reuse before a slot is taken, since it may be one of them
+    const long long parent_index = floor_div2(index);
+    const SampleChunk* same = valid(n->same[index - n->first], n->level, index);
+    const SampleChunk* parent =
+        valid(n->parents[parent_index - floor_div2(n->first)], n->level + 1, parent_index);
+    const SampleChunk* left =
+        valid(n->children[2 * (index - n->first)], n->level - 1, 2 * index);
+    const SampleChunk* right =
+        valid(n->children[2 * (index - n->first) + 1], n->level - 1, 2 * index + 1);
+
+    SampleJob* job = malloc(sizeof(SampleJob));
+    job->sampler = sampler;
+    job->known = KNOWN_NONE;
+    if (same != NULL) {
+        memcpy(job->base, same->base, sizeof(job->base));
+        job->known = KNOWN_ALL;
+    } else if (left != NULL && right != NULL) {
+        for (int i = 0; i < SAMPLER_CHUNK / 2; i++) {
+            job->base[i] = left->base[2 * i];
+            job->base[SAMPLER_CHUNK / 2 + i] = right->base[2 * i];
+        }
+        job->base[SAMPLER_CHUNK] = right->base[SAMPLER_CHUNK];
+        job->known = KNOWN_ALL;
+    } else if (parent != NULL) {
+        const int offset = index == 2 * parent_index ? 0 : SAMPLER_CHUNK / 2;
+        for (int i = 0; i <= SAMPLER_CHUNK / 2; i++)
+            job->base[2 * i] = parent->base[offset + i];
+        job->known = KNOWN_EVEN;
+    }
+
+    SampleChunk* chunk = evict(sampler);
+    if (chunk == NULL) {
+        free(job);
+        return;
+    }
+    chunk->level = n->level;
+    chunk->y_level = n->y_level;
+    chunk->index = index;
+    chunk->last_used = sampler->frame;
+    atomic_store_explicit(&chunk->state, CHUNK_QUEUED, memory_order_relaxed);
+    n->current[index - n->first] = chunk;
+
+    job->chunk = chunk;
+    atomic_fetch_add_explicit(&sampler->jobs, 1, memory_order_relaxed);
+    pool_submit(pool, sample_chunk, job);
+}
+
+static bool is_ready(const Neighbourhood* n, long long index)
+{
+    const SampleChunk* chunk = n->current[index - n->first];
+    return chunk != NULL &&
+           atomic_load_explicit(&chunk->state, memory_order_acquire) == CHUNK_READY;
+}
+
+bool sampler_update(Sampler* sampler, ThreadPool* pool, double min_x, double max_x, double pixel_x,
+                    double pixel_y)
+{
+    if (!(max_x > min_x) || !(pixel_x > 0) || !(pixel_y > 0))
+        return false;
+
+    // Samples at most a pixel apart, made coarser when the view would take too many chunks for
+    // the cache, which would evict each other every frame
+    Neighbourhood n;
+    n.level = (int)floor(log2(pixel_x));
+    n.y_level = (int)floor(log2(pixel_y));
+    const double margin = (max_x - min_x) / 2.0;
+    long long first, last;
+    for (;;) {
+        const double width = ldexp(SAMPLER_CHUNK, n.level);
+        first = (long long)floor(min_x / width);
+        last = (long long)floor(max_x / width);
+        n.first = (long long)floor((min_x - margin) / width);
+        n.last = (long long)floor((max_x + margin) / width);
+        if (n.last - n.first + 1 <= MAX_RANGE)
+            break;
+        n.level++;
+    }
+
+    // Nothing to do when the view still maps to the same chunks and they are all stitched
+    const long long key[4] = {n.level, n.y_level, n.first, n.last};
+    if (memcmp(key, sampler->request, sizeof(key)) == 0 && sampler->complete)
+        return false;
+    memcpy(sampler->request, key, sizeof(key));
+    sampler->complete = false;
+
+    sampler->frame++;
+    gather(sampler, &n);
+
+    // The visible chunks are queued first so the workers get to them first
+    for (long long i = first; i <= last; i++)
+        request(sampler, pool, &n, i);
+    for (long long d = 1; first - d >= n.first || last + d <= n.last; d++) {
+        if (last + d <= n.last)
+            request(sampler, pool, &n, last + d);
+        if (first - d >= n.first)
+            request(sampler, pool, &n, first - d);
+    }
+
+    for (long long i = first; i <= last; i++) {
+        if (!is_ready(&n, i))
+            return false;
+    }
+    long long lo = first, hi = last;
+    while (lo > n.first && is_ready(&n, lo - 1))
+        lo--;
+    while (hi < n.last && is_ready(&n, hi + 1))
+        hi++;
+    sampler->complete = lo == n.first && hi == n.last;
+
+    // While the margins fill in, keep what is stitched as long as it covers the view, so each
+    // view is stitched about twice rather than once per finished chunk
+    const bool same_grid = sampler->count > 0 && n.level == sampler->level &&
+                           n.y_level == sampler->y_level;
+    if (same_grid && lo == sampler->first && hi == sampler->last)
+        return false;
+    if (same_grid && !sampler->complete && sampler->first <= first && sampler->last >= last)
+        return false;
+
+    // Stitch the chunks together, ending with the first sample of the next chunk
+    size_t count = 1;
+    for (long long i = lo; i <= hi; i++)
+        count += n.current[i - n.first]->count;
+    if (count > sampler->capacity) {
+        sampler->xs = realloc(sampler->xs, count * sizeof(double));
+        sampler->ys = realloc(sampler->ys, count * sizeof(double));
+        sampler->capacity = count;
+    }
+    size_t total = 0;
+    for (long long i = lo; i <= hi; i++) {
+        const SampleChunk* chunk = n.current[i - n.first];
+        memcpy(sampler->xs + total, chunk->xs, chunk->count * sizeof(double));
+        memcpy(sampler->ys + total, chunk->ys, chunk->count * sizeof(double));
+        total += chunk->count;
+    }
+    sampler->xs[total] = (double)((hi + 1) * SAMPLER_CHUNK) * ldexp(1.0, n.level);
+    sampler->ys[total] = n.current[hi - n.first]->base[SAMPLER_CHUNK];
+    sampler->count = total + 1;
+
+    sampler->level = n.level;
+    sampler->y_level = n.y_level;
+    sampler->first = lo;
+    sampler->last = hi;
+    return true;
+}
@@ -0,0 +1,236 @@
+// poll() and the socket API are not part of strict C17
+#define _DEFAULT_SOURCE
+
+#include "tail.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "loader.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <io.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Samples are handed to the ring in batches so the shared index is written once per batch
+#define PUSH_BATCH 256
+#define READ_BUFFER (1 << 16)
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct
+{
+    Tail* tail;
+    TailSample batch[PUSH_BATCH];
+    int count;
+    size_t sequence; // x of samples that come without one
+} Producer;
+
+static void flush(Producer* producer)
+{
+    Tail* tail = producer->tail;
+    const size_t pushed = ring_push(&tail->ring, producer->batch, (size_t)producer->count);
+    atomic_fetch_add_explicit(&tail->received, (size_t)producer->count, memory_order_relaxed);
+    if (pushed < (size_t)producer->count) {
+        atomic_fetch_add_explicit(&tail->dropped, (size_t)producer->count - pushed,
+                                  memory_order_relaxed);
+    }
+    producer->count = 0;
+}
+
+// Parses every complete line in [text, end) and returns where the unfinished last line starts
+static const char* parse_lines(Producer* producer, const char* text, const char* end,
+                               bool complete)
+{
+    const double arrival = now();
+    while (text < end) {
+        const char* line_end = memchr(text, '\n', (size_t)(end - text));
+        if (line_end == NULL) {
+            if (!complete)
+                break;
+            line_end = end;
+        }
+
+        double values[3];
+        const int found = parse_values(text, line_end, values, 3);
+        text = line_end + 1;
+        if (found == 0)
+            continue;
+
+        TailSample* sample = &producer->batch[producer->count++];
+        sample->x = found >= 2 ? values[0] : (double)producer->sequence;
+        sample->y = found >= 2 ? values[1] : values[0];
+        sample->time = found >= 3 ? values[2] : arrival;
+        producer->sequence++;
+        if (producer->count == PUSH_BATCH)
+            flush(producer);
+    }
+    if (producer->count > 0)
+        flush(producer);
+    return text < end ? text : end;
+}
+
+// Platform layer: waiting for input with a timeout so the thread notices when it should stop
+
+#ifdef _WIN32
+typedef SOCKET Socket;
+#define INVALID INVALID_SOCKET
+#else
+typedef int Socket;
+#define INVALID (-1)
+#define closesocket close
+#endif
+
+static bool wait_readable(Socket socket)
+{
+#ifdef _WIN32
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(socket, &set);
+    struct timeval timeout = {0, 100 * 1000};
+    return select(0, &set, NULL, NULL, &timeout) > 0;
+#else
+    struct pollfd fd = {socket, POLLIN, 0};
+    return poll(&fd, 1, 100) > 0;
+#endif
+}
+
+static void* udp_thread(void* arg)
+{
+    Tail* tail = arg;
+    Producer producer = {.tail = tail};
+    char* buffer = malloc(READ_BUFFER);
+
+    while (buffer != NULL && !atomic_load_explicit(&tail->stop, memory_order_relaxed)) {
+        if (!wait_readable((Socket)tail->socket))
+            continue;
+        const int size = recv((Socket)tail->socket, buffer, READ_BUFFER, 0);
+        if (size > 0)
+            parse_lines(&producer, buffer, buffer + size, true);
+    }
+    free(buffer);
+    return NULL;
+}
+
+static void* stdin_thread(void* arg)
+{
+    Tail* tail = arg;
+    Producer producer = {.tail = tail};
+    char* buffer = malloc(READ_BUFFER);
+    size_t pending = 0;
+
+    while (buffer != NULL && !atomic_load_explicit(&tail->stop, memory_order_relaxed)) {
+#ifdef _WIN32
+        // Console and pipe handles cannot be waited on with select(); this read blocks
+        const int size = _read(0, buffer + pending, (unsigned)(READ_BUFFER - pending));
+#else
+        struct pollfd fd = {0, POLLIN, 0};
+        if (poll(&fd, 1, 100) <= 0)
+            continue;
+        const ssize_t size = read(0, buffer + pending, READ_BUFFER - pending);
+#endif
+        if (size <= 0) {
+            parse_lines(&producer, buffer, buffer + pending, true);
+            break;
+        }
+
+        const char* end = buffer + pending + size;
+        const char* rest = parse_lines(&producer, buffer, end, false);
+        pending = (size_t)(end - rest);
+        if (pending == READ_BUFFER)
+            pending = 0; // A line longer than the buffer is not a sample
+        memmove(buffer, rest, pending);
+    }
+    free(buffer);
+    atomic_store_explicit(&tail->ended, true, memory_order_release);
+    return NULL;
+}
+
+bool is_tail_source(const char* arg)
+{
+    return strcmp(arg, "-") == 0 || strncmp(arg, "udp:", 4) == 0;
+}
+
+bool tail_start(Tail* tail, const char* source, size_t ring_capacity)
+{
+    memset(tail, 0, sizeof(*tail));
+    tail->udp = strncmp(source, "udp:", 4) == 0;
+    tail->socket = INVALID;
+
+    if (tail->udp) {
+        const int port = atoi(source + 4);
+#ifdef _WIN32
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+        const Socket s = socket(AF_INET, SOCK_DGRAM, 0);
+        struct sockaddr_in address = {0};
+        address.sin_family = AF_INET;
+        address.sin_port = htons((unsigned short)port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (s == INVALID || port <= 0 ||
+            bind(s, (struct sockaddr*)&address, sizeof(address)) != 0) {
+            fprintf(stderr, "%s: cannot listen on UDP port %d\n", source, port);
+            if (s != INVALID)
+                closesocket(s);
+            return false;
+        }
+
+        // Bursts must not overflow the kernel buffer while the thread is busy parsing
+        int buffer_size = 8 << 20;
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&buffer_size, sizeof(buffer_size));
+        tail->socket = (long long)s;
+    }
+
+    if (!ring_init(&tail->ring, ring_capacity)) {
+        fprintf(stderr, "%s: cannot allocate a ring of %zu samples\n", source, ring_capacity);
+        tail_close(tail);
+        return false;
+    }
+    if (pthread_create(&tail->thread, NULL, tail->udp ? udp_thread : stdin_thread, tail) != 0) {
+        fprintf(stderr, "%s: cannot start the reader thread\n", source);
+        tail_close(tail);
+        return false;
+    }
+    tail->started = true;
+    return true;
+}
+
+void tail_close(Tail* tail)
+{
+    if (tail->started) {
+        atomic_store(&tail->stop, true);
+#ifdef _WIN32
+        // The thread may be stuck in a blocking read of standard input. It is left running and
+        // the ring it writes to is not freed; this only happens when the program exits.
+        if (!tail->udp && !atomic_load(&tail->ended)) {
+            pthread_detach(tail->thread);
+            return;
+        }
+#endif
+        pthread_join(tail->thread, NULL);
+    }
+    if (tail->udp && (Socket)tail->socket != INVALID) {
+        closesocket((Socket)tail->socket);
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+    ring_free(&tail->ring);
+    tail->started = false;
+}